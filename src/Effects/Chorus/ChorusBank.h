@@ -0,0 +1,232 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__ChorusBank_h)
+#define __ChorusBank_h
+
+#include "OnePoleLP.h"
+#include "Math.h"
+#include "../../Engine/DelayLine.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CHORUSBANK_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// The four chorus taps of ChorusEngine. Both taps of a channel read the
+// same delay line, its guard keeps both samples of an interpolated read in
+// a row. A block is written to the delay lines before it is read, as there
+// is no feedback the taps see the same samples as when processing sample by
+// sample. The four taps are then interpolated and low passed as one SSE
+// vector.
+class ChorusBank 
+{
+public:
+	enum Tap
+	{
+		CHORUS1L = 0,
+		CHORUS1R,
+		CHORUS2L,
+		CHORUS2R,
+		NUM_TAPS
+	};
+
+	static const int MAX_BLOCK_SIZE = 64;
+
+	int delayLineLength;
+
+private:
+	// Left and right delay line
+	DelayLine *delayLines[2];
+
+	float sampleRate;
+	float delayTime;
+
+	// Triangle lfo per tap
+	float lfoRate[NUM_TAPS];
+	float lfoStartPhase[NUM_TAPS];
+	float lfoPhase[NUM_TAPS];
+	float lfoSign[NUM_TAPS];
+	float lfoStepSize[NUM_TAPS];
+
+	// Allpass interpolation and low pass state per tap
+	float z1[NUM_TAPS];
+	float lowPass[NUM_TAPS];
+	float lowPassCoefficient;
+
+	// Block buffers, sample major so one sample of all taps is contiguous
+	float tap1[MAX_BLOCK_SIZE * NUM_TAPS];
+	float tap2[MAX_BLOCK_SIZE * NUM_TAPS];
+	float fracInverted[MAX_BLOCK_SIZE * NUM_TAPS];
+
+	float vsa;   // Very small amount (Denormal Fix)
+
+public:
+	ChorusBank(float sampleRate)
+	{
+		// rate, phase of the former Chorus objects
+		lfoRate[CHORUS1L]= 0.5f;  lfoStartPhase[CHORUS1L]= 1.0f;
+		lfoRate[CHORUS1R]= 0.5f;  lfoStartPhase[CHORUS1R]= 0.0f;
+		lfoRate[CHORUS2L]= 0.83f; lfoStartPhase[CHORUS2L]= 0.0f;
+		lfoRate[CHORUS2R]= 0.83f; lfoStartPhase[CHORUS2R]= 1.0f;
+		delayTime= 7.0f;
+
+		int capacity= getDelayLineLength(sampleRate);
+		delayLines[0]= new DelayLine(capacity, MAX_BLOCK_SIZE);
+		delayLines[1]= new DelayLine(capacity, MAX_BLOCK_SIZE);
+
+		lowPassCoefficient= OnePoleLP::getCoefficient(0.95f);
+		vsa= (1.0f/4294967295.0f);
+
+		setSampleRate(sampleRate);
+	}
+
+	~ChorusBank()
+	{
+		delete delayLines[0];
+		delete delayLines[1];
+	}
+
+	// Reuses the delay lines and starts from silence, false if the
+	// delay lines are too short for the sample rate
+	bool setSampleRate(float sampleRate)
+	{
+		int length= getDelayLineLength(sampleRate);
+		if (length > delayLines[0]->getCapacity())
+		{
+			return false;
+		}
+		this->sampleRate= sampleRate;
+		delayLineLength= length;
+		delayLines[0]->setLength(length);
+		delayLines[1]->setLength(length);
+
+		for (int tap = 0; tap < NUM_TAPS; tap++)
+		{
+			lfoPhase[tap]= lfoStartPhase[tap]*2.0f-1.0f;
+			lfoSign[tap]= 1.0f;
+			lfoStepSize[tap]= 4.0f*lfoRate[tap]/sampleRate;
+			z1[tap]= 0.0f;
+			lowPass[tap]= 0.0f;
+		}
+		return true;
+	}
+
+	// At most MAX_BLOCK_SIZE samples, output: NUM_TAPS values per sample
+	inline void process(const float *inputL, const float *inputR, float *output, const int numSamples)
+	{
+		delayLines[0]->write(inputL, numSamples);
+		delayLines[1]->write(inputR, numSamples);
+
+		readTaps(numSamples);
+		processTaps(output, numSamples);
+	}
+
+private:
+	//add extra point to aid in interpolation later
+	int getDelayLineLength(float sampleRate)
+	{
+		return ((int)floorf(delayTime*sampleRate*0.001f) + 1 +2000);
+	}
+
+	// Renders the lfo and reads both interpolation points of every tap
+	inline void readTaps(const int numSamples)
+	{
+		for (int tap = 0; tap < NUM_TAPS; tap++)
+		{
+			// Left taps are even
+			const DelayLine *delayLine= delayLines[tap & 1];
+			const float *lineData= delayLine->getData();
+			float phase= lfoPhase[tap];
+			float sign= lfoSign[tap];
+			const float stepSize= lfoStepSize[tap];
+
+			for (int i = 0; i < numSamples; i++)
+			{
+				if (phase>=1.0f) 
+				{
+					sign= -1.0f;
+				} 
+				else if (phase<=-1.0f) 
+				{
+					sign= +1.0f;
+				}
+				phase+= stepSize*sign;
+
+				// The block has been written, sample i is numSamples - i
+				// samples old
+				float offset= (phase*0.3f+0.4f)*delayTime*sampleRate*0.001f;
+				int offsetInt= (int)offset;
+				const float *data= lineData + delayLine->getReadPosition(numSamples - i + offsetInt + 1);
+
+				tap1[i * NUM_TAPS + tap]= data[1];
+				tap2[i * NUM_TAPS + tap]= data[0];
+				fracInverted[i * NUM_TAPS + tap]= 1.0f - (offset - offsetInt);
+			}
+			lfoPhase[tap]= phase;
+			lfoSign[tap]= sign;
+		}
+	}
+
+	// Allpass interpolation followed by the one pole low pass of all taps
+	inline void processTaps(float *output, const int numSamples)
+	{
+		const float p= lowPassCoefficient;
+		int i= 0;
+#if defined(CHORUSBANK_USE_SSE)
+		__m128 z1Vector= _mm_loadu_ps(z1);
+		__m128 lowPassVector= _mm_loadu_ps(lowPass);
+		const __m128 pVector= _mm_set1_ps(p);
+		const __m128 inputGain= _mm_set1_ps(1.0f - p);
+		const __m128 vsaVector= _mm_set1_ps(vsa);
+		for (; i < numSamples; i++)
+		{
+			const int index= i * NUM_TAPS;
+
+			// tap2 + tap1 * (1 - frac) - (1 - frac) * z1
+			const __m128 fracVector= _mm_loadu_ps(fracInverted + index);
+			__m128 out= _mm_add_ps(_mm_loadu_ps(tap2 + index), _mm_mul_ps(_mm_loadu_ps(tap1 + index), fracVector));
+			out= _mm_sub_ps(out, _mm_mul_ps(fracVector, z1Vector));
+			z1Vector= out;
+
+			lowPassVector= _mm_add_ps(_mm_add_ps(_mm_mul_ps(inputGain, out), _mm_mul_ps(pVector, lowPassVector)), vsaVector);
+			_mm_storeu_ps(output + index, lowPassVector);
+		}
+		_mm_storeu_ps(z1, z1Vector);
+		_mm_storeu_ps(lowPass, lowPassVector);
+#endif
+		for (; i < numSamples; i++)
+		{
+			const int index= i * NUM_TAPS;
+			for (int tap = 0; tap < NUM_TAPS; tap++)
+			{
+				float out= tap2[index + tap]+tap1[index + tap]*fracInverted[index + tap]-fracInverted[index + tap]*z1[tap];
+				z1[tap]= out;
+				lowPass[tap]= (1.0f-p)*out + p*lowPass[tap]+vsa;
+				output[index + tap]= lowPass[tap];
+			}
+		}
+	}
+};
+
+#endif
@@ -20,22 +20,22 @@
 	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 	==============================================================================
  */
-
 #if !defined(__ChorusEngine_h)
 #define __ChorusEngine_h
 
-#include "Chorus.h"
+#include "ChorusBank.h"
 #include "Params.h"
 #include "DCBlock.h"
+#include "../../Engine/TailDetector.h"
 
-
+// The chorus bank is allocated by allocateBuffers on a non audio thread
+// when a chorus gets enabled, and released after it has been idle for
+// the release time. Until swapBuffers has installed it the chorus is
+// bypassed.
 class ChorusEngine 
 {
 public:
-    Chorus *chorus1L;
-    Chorus *chorus1R;
-    Chorus *chorus2L;
-    Chorus *chorus2R;
+    ChorusBank *chorusBank;
 
     DCBlock *dcBlock1L;
     DCBlock *dcBlock1R;
@@ -45,71 +45,249 @@ class ChorusEngine
     bool isChorus1Enabled;
     bool isChorus2Enabled;
 
+    TailDetector *tailDetector;
+
+private:
+    // Allocated or released bank waiting for swapBuffers, then freed
+    ChorusBank *pendingChorusBank;
+    bool isSwapPending;
+
+    // What allocateBuffers has to do, decided by updateAllocation
+    bool isAllocationNeeded;
+    bool isReleaseNeeded;
+
+    float sampleRate;
+    float bufferSampleRate;
+    float pendingSampleRate;
+
+    // Samples the chorus has been bypassed or silent
+    int idleSamples;
+    int releaseSamples;
+    float releaseTime;
+
+    // Chorus taps of one block
+    float taps[ChorusBank::MAX_BLOCK_SIZE * ChorusBank::NUM_TAPS];
+
+public:
     ChorusEngine(float sampleRate) 
     {
         dcBlock1L= new DCBlock();
         dcBlock1R= new DCBlock();
         dcBlock2L= new DCBlock();
         dcBlock2R= new DCBlock();
+        tailDetector= new TailDetector(0);
+
+        chorusBank= 0;
+        pendingChorusBank= 0;
+        isSwapPending= false;
+        isAllocationNeeded= false;
+        isReleaseNeeded= false;
+        bufferSampleRate= 0.0f;
+        pendingSampleRate= 0.0f;
 
-        setUpChorus(sampleRate);
+        this->sampleRate= sampleRate;
+        idleSamples= 0;
+        releaseSamples= 0;
+        setReleaseTime(10.0f);
+        setEnablesChorus(false, false);
     }
 
     ~ChorusEngine()
     {
-        delete chorus1L;
-        delete chorus1R;
-        delete chorus2L;
-        delete chorus2R;
+        delete chorusBank;
+        delete pendingChorusBank;
         delete dcBlock1L;
         delete dcBlock1R;
         delete dcBlock2L;
         delete dcBlock2R;
-
+        delete tailDetector;
     }
 
+    // Reuses the chorus bank if it is long enough for the sample rate,
+    // otherwise they are reallocated by the next allocateBuffers
     void setSampleRate(float sampleRate)
     {
-        setUpChorus(sampleRate);
+        this->sampleRate= sampleRate;
+        setReleaseTime(releaseTime);
+        if (isAllocated() && !isSwapPending)
+        {
+            if (chorusBank->setSampleRate(sampleRate))
+            {
+                bufferSampleRate= sampleRate;
+                tailDetector->setHoldSamples(chorusBank->delayLineLength);
+            }
+        }
         setEnablesChorus(false, false);
     }
 
+    // Seconds the chorus bank is kept after the chorus went idle
+    void setReleaseTime(float seconds)
+    {
+        bool isIdle= idleSamples >= releaseSamples;
+        releaseTime= seconds;
+        releaseSamples= (int)(seconds * sampleRate);
+        if (isIdle) idleSamples= releaseSamples;
+    }
+
     void setEnablesChorus(bool isChorus1Enabled, bool isChorus2Enabled)
     {
         this->isChorus1Enabled = isChorus1Enabled;
         this->isChorus2Enabled = isChorus2Enabled;
     }
 
-    void setUpChorus(float sampleRate)
+    bool isAllocated()
     {
-        chorus1L= new Chorus(sampleRate, 1.0f, 0.5f, 7.0f);
-        chorus1R= new Chorus(sampleRate, 0.0f, 0.5f, 7.0f);
-        chorus2L= new Chorus(sampleRate, 0.0f, 0.83f, 7.0f);
-        chorus2R= new Chorus(sampleRate, 1.0f, 0.83f, 7.0f);
+        return chorusBank != 0;
+    }
+
+    // Call with the audio thread locked, reads the state the audio thread
+    // changes and decides what allocateBuffers has to do.
+    // isUsed is false if process is not called at all.
+    void updateAllocation(bool isUsed)
+    {
+        isAllocationNeeded= false;
+        isReleaseNeeded= false;
+        if (!isSwapPending)
+        {
+            bool isInUse= isUsed && (isChorus1Enabled || isChorus2Enabled || idleSamples < releaseSamples);
+            bool isCurrent= isAllocated() && bufferSampleRate == sampleRate;
+            if (isInUse && !isCurrent)
+            {
+                pendingSampleRate= sampleRate;
+                isAllocationNeeded= true;
+            }
+            else if (!isInUse && isAllocated())
+            {
+                isReleaseNeeded= true;
+            }
+        }
     }
 
-    inline void process(float *sampleL, float *sampleR) 
+    // Non audio thread after updateAllocation, allocates or schedules the
+    // release of the chorus bank. Returns true if swapBuffers has to be called.
+    bool allocateBuffers()
     {
-        float resultR= 0.0f;
-        float resultL= 0.0f;
-        if (isChorus1Enabled) 
+        if (isAllocationNeeded)
         {
-            resultL+= chorus1L->process(sampleL);
-            resultR+= chorus1R->process(sampleR);
-            dcBlock1L->tick(&resultL, 0.01f);
-            dcBlock1R->tick(&resultR, 0.01f);
+            pendingChorusBank= new ChorusBank(pendingSampleRate);
+            isSwapPending= true;
         }
-        if (isChorus2Enabled) 
+        else if (isReleaseNeeded)
         {
-            resultL+= chorus2L->process(sampleL);
-            resultR+= chorus2R->process(sampleR);
-            dcBlock2L->tick(&resultL, 0.01f);
-            dcBlock2R->tick(&resultR, 0.01f);
+            isSwapPending= true;
+        }
+        isAllocationNeeded= false;
+        isReleaseNeeded= false;
+        return isSwapPending;
+    }
+
+    // Call with the audio thread locked, only exchanges pointers
+    void swapBuffers()
+    {
+        if (isSwapPending)
+        {
+            ChorusBank *previous= chorusBank;
+            chorusBank= pendingChorusBank;
+            pendingChorusBank= previous;
+            bufferSampleRate= pendingSampleRate;
+            if (isAllocated())
+            {
+                // Skip once everything in the delay lines has been played out
+                tailDetector->setHoldSamples(chorusBank->delayLineLength);
+            }
+            isSwapPending= false;
+        }
+    }
+
+    // Non audio thread, after swapBuffers
+    void freeBuffers()
+    {
+        if (!isSwapPending)
+        {
+            delete pendingChorusBank;
+            pendingChorusBank= 0;
+        }
+    }
+
+    inline void process(float *sampleL, float *sampleR, int numSamples) 
+    {
+        while (numSamples > 0)
+        {
+            int blockSize= numSamples < ChorusBank::MAX_BLOCK_SIZE ? numSamples : ChorusBank::MAX_BLOCK_SIZE;
+            processBlock(sampleL, sampleR, blockSize);
+            sampleL+= blockSize;
+            sampleR+= blockSize;
+            numSamples-= blockSize;
+        }
+    }
+
+private:
+    inline void addIdleSamples(int numSamples)
+    {
+        idleSamples+= numSamples;
+        if (idleSamples > releaseSamples) idleSamples= releaseSamples;
+    }
+
+    inline void processBlock(float *sampleL, float *sampleR, const int numSamples) 
+    {
+        bool isEnabled= isChorus1Enabled || isChorus2Enabled;
+        if (!isEnabled || !isAllocated() || bufferSampleRate != sampleRate)
+        {
+            addIdleSamples(numSamples);
+            return;
+        }
+
+        // Only skipped if the whole block is silent
+        bool isSilent= true;
+        for (int i = 0; i < numSamples; i++)
+        {
+            isSilent&= tailDetector->isSilent(sampleL[i], sampleR[i]);
+        }
+        if (isSilent)
+        {
+            addIdleSamples(numSamples);
+            return;
+        }
+        idleSamples= 0;
+
+        chorusBank->process(sampleL, sampleR, taps, numSamples);
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            const float *tap= &taps[i * ChorusBank::NUM_TAPS];
+            float resultR= 0.0f;
+            float resultL= 0.0f;
+
+            // Delay line output before the dc blockers, their denormal offset
+            // would never let the tail decay below the threshold
+            float tailR= 0.0f;
+            float tailL= 0.0f;
+            if (isChorus1Enabled) 
+            {
+                resultL= tap[ChorusBank::CHORUS1L];
+                resultR= tap[ChorusBank::CHORUS1R];
+                tailL= resultL;
+                tailR= resultR;
+                dcBlock1L->tick(&resultL, 0.01f);
+                dcBlock1R->tick(&resultR, 0.01f);
+            }
+            if (isChorus2Enabled) 
+            {
+                float chorusL= tap[ChorusBank::CHORUS2L];
+                float chorusR= tap[ChorusBank::CHORUS2R];
+                tailL+= chorusL;
+                tailR+= chorusR;
+                resultL+= chorusL;
+                resultR+= chorusR;
+                dcBlock2L->tick(&resultL, 0.01f);
+                dcBlock2R->tick(&resultR, 0.01f);
+            }
+            tailDetector->tick(tailL, tailR);
+
+            sampleL[i]= sampleL[i]+resultL*1.4f;
+            sampleR[i]= sampleR[i]+resultR*1.4f;
         }
-        *sampleL= *sampleL+resultL*1.4f;
-        *sampleR= *sampleR+resultR*1.4f;
     }
 };
 
 #endif
-
@@ -30,16 +30,29 @@ class OnePoleLP
   float inputs, outputs, lastOutput;
   float vsa;   // Very small amount (Denormal Fix)
 
+  // Coefficient of the last cutoff
+  float cutoff, p;
 
   OnePoleLP() 
   {
     lastOutput = inputs = outputs = 0.0f;
     vsa= (1.0f/4294967295.0f);   // Very small amount (Denormal Fix)
+    cutoff = 0.0f;
+    p = getCoefficient(cutoff);
+  }
+
+  static inline float getCoefficient(float cutoff)
+  {
+    return (cutoff*0.98f)*(cutoff*0.98f)*(cutoff*0.98f)*(cutoff*0.98f);
   }
 
   void tick(float *sample, float cutoff) 
   {
-    float p = (cutoff*0.98f)*(cutoff*0.98f)*(cutoff*0.98f)*(cutoff*0.98f);
+    if (cutoff != this->cutoff)
+    {
+      this->cutoff = cutoff;
+      p = getCoefficient(cutoff);
+    }
     outputs = (1.0f-p)*(*sample) + p*outputs+vsa;
     *sample= outputs;
   }
@@ -26,13 +26,17 @@
 
 #include "Math.h"
 #include "AudioUtils.h"
+#include "DelayLine.h"
 
 class AllPassFilter
 {
 private:
+	// Longest block processed without wrapping
+	static const int MAX_BLOCK_SIZE = 64;
+
 	float delay, gain;
-	float* buffer;
-	int bufferLength, writePtr, readPtr1, readPtr2;
+	DelayLine *delayLine;
+	int bufferLength;
 	float z1;
 
 	AudioUtils audioUtils;
@@ -45,22 +49,30 @@ class AllPassFilter
 		gain = feedbackGain;
 		delay = delayTime;
 
-		bufferLength = (int)(delay * samplingRate / 1000.0f);
-		bufferLength = audioUtils.getNextNearPrime(bufferLength);
-		buffer = new float[bufferLength];
-
-		//zero out the buffer (create silence)
-		for (int i = 0; i < bufferLength; i++)
-			buffer[i] = 0.0f;
+		bufferLength = getBufferLength((float)samplingRate);
+		delayLine = new DelayLine(bufferLength, MAX_BLOCK_SIZE);
 
-		writePtr = readPtr1 = readPtr2 = 0;
 		z1 = 0.0f;
 		//OutputDebugString("end init allPass");
 	}
 
 	~AllPassFilter()
 	{
-		delete buffer;
+		delete delayLine;
+	}
+
+	// Reuses the delay line and starts from silence, false if the
+	// delay line is too short for the sample rate
+	bool setSampleRate(float sampleRate)
+	{
+		int length = getBufferLength(sampleRate);
+		if (!delayLine->setLength(length))
+		{
+			return false;
+		}
+		bufferLength = length;
+		z1 = 0.0f;
+		return true;
 	}
 
 	// all values [0..1]
@@ -68,60 +80,75 @@ class AllPassFilter
 	{
 		// dynamic interpolated
 		float offset = (bufferLength - 2.0f) * delayLength + 1.0f;
-		readPtr1 = writePtr - (int)floorf(offset);
-
-		if (readPtr1 < 0)
-			readPtr1 += bufferLength;
+		int offsetInt = (int)floorf(offset);
 
-		readPtr2 = readPtr1 - 1;
-		if (readPtr2 < 0)
-			readPtr2 += bufferLength;
+		// The older sample first, the guard keeps both in a row
+		const float *data = delayLine->getData() + delayLine->getReadPosition(offsetInt + 1);
 
 		// interpolate, see paper: http://www.stanford.edu/~dattorro/EffectDesignPart2.pdf
-		float frac = offset - (int)floorf(offset);
-		float temp = buffer[readPtr2] + buffer[readPtr1] * (1-frac) - (1-frac) * z1;
+		float frac = offset - offsetInt;
+		float temp = data[0] + data[1] * (1-frac) - (1-frac) * z1;
 		z1 = temp;
 
 		float output;
 		if (!negative)
 		{
-			buffer[writePtr] = diffuse * gain * temp + input;
-			output = temp - diffuse * gain * buffer[writePtr];
+			float feedback = diffuse * gain * temp + input;
+			delayLine->write(feedback);
+			output = temp - diffuse * gain * feedback;
 		}
 		else
 		{
-			buffer[writePtr] = diffuse * gain * temp - input;
-			output = temp + diffuse * gain * buffer[writePtr];
+			float feedback = diffuse * gain * temp - input;
+			delayLine->write(feedback);
+			output = temp + diffuse * gain * feedback;
 		}
 
-		if (++writePtr >= bufferLength)
-			writePtr = 0;
-
 		return output;
 	}
 
 	inline float process(float input, float diffuse)
 	{
-		float temp = buffer[readPtr1];
-		buffer[readPtr1] = diffuse * gain * temp + input;
-		float output = temp - diffuse * gain * buffer[readPtr1];
-
-		if (++readPtr1 >= bufferLength)
-			readPtr1 = 0;
-
-		return output;
+		float temp = delayLine->read(bufferLength);
+		float feedback = diffuse * gain * temp + input;
+		delayLine->write(feedback);
+		return temp - diffuse * gain * feedback;
 	}
 
 	inline float process(float input)
 	{
-		float temp = buffer[readPtr1];
-		buffer[readPtr1] = gain * temp + input;
-		float output = temp - gain * buffer[readPtr1];
+		float temp = delayLine->read(bufferLength);
+		float feedback = gain * temp + input;
+		delayLine->write(feedback);
+		return temp - gain * feedback;
+	}
 
-		if (++readPtr1 >= bufferLength)
-			readPtr1 = 0;
+	// In place, the samples of a block are read and written in a row
+	inline void process(float *samples, int numSamples)
+	{
+		while (numSamples > 0)
+		{
+			int blockSize = delayLine->getGuardLength();
+			if (blockSize > numSamples) blockSize = numSamples;
+
+			float *data = delayLine->getWritePointer();
+			for (int i = 0; i < blockSize; i++)
+			{
+				float temp = data[i];
+				data[i] = gain * temp + samples[i];
+				samples[i] = temp - gain * data[i];
+			}
+			delayLine->advance(blockSize);
+
+			samples += blockSize;
+			numSamples -= blockSize;
+		}
+	}
 
-		return output;
+private:
+	int getBufferLength(float sampleRate)
+	{
+		return audioUtils.getNextNearPrime((int)(delay * sampleRate / 1000.0f));
 	}
 };
-#endif
\ No newline at end of file
+#endif
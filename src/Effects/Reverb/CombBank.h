@@ -0,0 +1,334 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__CombBank_h)
+#define __CombBank_h
+
+#include "Math.h"
+#include "AudioUtils.h"
+#include "DelayLine.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define COMBBANK_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// The 4 left and 4 right modulated comb filters of the reverb in one bank.
+// The state of all lines is stored side by side, so one sample of all 8 lines
+// is two SSE vectors of 4. A block is never longer than the shortest current
+// delay, so every tap of the block is read before the block writes any of them.
+class CombBank
+{
+public:
+	static const int NUM_LINES = 8;
+	static const int NUM_LINES_PER_CHANNEL = 4;
+	static const int MAX_BLOCK_SIZE = 64;
+
+private:
+	DelayLine *lines[NUM_LINES];
+	int lineLength[NUM_LINES];
+
+	// In milliseconds
+	float delayTime[NUM_LINES];
+
+	// Allpass interpolation state
+	float z1[NUM_LINES];
+
+	// Delay modulation, a filtered triangle with random periods per line.
+	// It moves far too slowly to be heard within a block, so it is advanced
+	// once per block and the read offsets are interpolated across the block.
+	float modulationValue[NUM_LINES];
+	float modulationDelta[NUM_LINES];
+	float modulationFiltered[NUM_LINES];
+	unsigned int randSeed[NUM_LINES];
+	float modulationDepth;
+
+	// Decay of the modulation filter over n samples
+	float modulationDecay[MAX_BLOCK_SIZE + 1];
+
+	// Read offset at the start of the block and its change per sample
+	float offsetStart[NUM_LINES];
+	float offsetDelta[NUM_LINES];
+
+	// Block buffers, sample major so one sample of all lines is contiguous
+	float tap1[MAX_BLOCK_SIZE * NUM_LINES];
+	float tap2[MAX_BLOCK_SIZE * NUM_LINES];
+	float fracInverted[MAX_BLOCK_SIZE * NUM_LINES];
+	float offsets[MAX_BLOCK_SIZE * NUM_LINES];
+	float output[MAX_BLOCK_SIZE * NUM_LINES];
+	float feedbackOutput[MAX_BLOCK_SIZE * NUM_LINES];
+
+	AudioUtils audioUtils;
+
+public:
+	// delayTimes: NUM_LINES delay times in milliseconds, left lines first
+	CombBank(const float *delayTimes, long samplingRate)
+	{
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			delayTime[i] = delayTimes[i];
+			lines[i] = new DelayLine(getLineLength(i, (float)samplingRate), MAX_BLOCK_SIZE);
+		}
+		modulationDepth = 0.012f;
+		setSampleRate((float)samplingRate);
+
+		// Exponential averager of 5000 old to 1 new per sample
+		for (int i = 0; i <= MAX_BLOCK_SIZE; i++)
+		{
+			modulationDecay[i] = powf(5000.0f / 5001.0f, (float)i);
+		}
+	}
+
+	~CombBank()
+	{
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			delete lines[i];
+		}
+	}
+
+	// Reuses the delay lines and starts from silence, false if the
+	// delay lines are too short for the sample rate
+	bool setSampleRate(float sampleRate)
+	{
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			if (getLineLength(i, sampleRate) > lines[i]->getCapacity())
+			{
+				return false;
+			}
+		}
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			lineLength[i] = getLineLength(i, sampleRate);
+			lines[i]->setLength(lineLength[i]);
+			z1[i] = 0.0f;
+
+			modulationValue[i] = 0.0f;
+			modulationFiltered[i] = 0.0f;
+			randSeed[i] = i + 1;
+			getNextRandomPeriod(i, 1.0f);
+		}
+		return true;
+	}
+
+	// feedback, delay [0..1]
+	// outputL, outputR: sum of the left and right lines with alternating sign
+	inline void process(const float *input, float *outputL, float *outputR, int numSamples, float feedback, float delay)
+	{
+		while (numSamples > 0)
+		{
+			int blockSize = getMaxBlockSize(delay);
+			if (blockSize > numSamples) blockSize = numSamples;
+
+			updateModulation(blockSize, delay);
+			renderOffsets(blockSize);
+			readTaps(blockSize);
+			processLines(input, blockSize, feedback);
+			writeLines(blockSize);
+
+			for (int i = 0; i < blockSize; i++)
+			{
+				const float *out = output + i * NUM_LINES;
+				outputL[i] = out[0] - out[1] + out[2] - out[3];
+				outputR[i] = out[4] - out[5] + out[6] - out[7];
+			}
+
+			input += blockSize;
+			outputL += blockSize;
+			outputR += blockSize;
+			numSamples -= blockSize;
+		}
+	}
+
+private:
+	int getLineLength(const int line, const float sampleRate)
+	{
+		return audioUtils.getNextNearPrime((int)(delayTime[line] * sampleRate / 1000));
+	}
+
+	// The modulation is [0..1] and only makes the delays longer, so the
+	// unmodulated delay of the shortest line bounds the block
+	inline int getMaxBlockSize(float delay)
+	{
+		int blockSize = MAX_BLOCK_SIZE;
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			int offset = (int)((lineLength[i] - 2) * delay + 1.0f);
+			if (offset < blockSize) blockSize = offset;
+		}
+		return blockSize;
+	}
+
+	// Advances the modulation of every line by the block and sets up the
+	// read offsets, the delay is [0..1]
+	inline void updateModulation(const int numSamples, const float delay)
+	{
+		for (int line = 0; line < NUM_LINES; line++)
+		{
+			const float scale = (float)(lineLength[line] - 2);
+			float start = scale * (delay + modulationDepth * modulationFiltered[line]) + 1.0f;
+			float end = scale * (delay + modulationDepth * tickModulation(line, numSamples)) + 1.0f;
+			offsetStart[line] = start;
+			offsetDelta[line] = (end - start) / numSamples;
+		}
+	}
+
+	// Linear interpolated read offsets of the block, all lines at once
+	inline void renderOffsets(const int numSamples)
+	{
+		int i = 0;
+#if defined(COMBBANK_USE_SSE)
+		const __m128 deltaL = _mm_loadu_ps(offsetDelta);
+		const __m128 deltaR = _mm_loadu_ps(offsetDelta + NUM_LINES_PER_CHANNEL);
+		__m128 offsetL = _mm_loadu_ps(offsetStart);
+		__m128 offsetR = _mm_loadu_ps(offsetStart + NUM_LINES_PER_CHANNEL);
+		for (; i < numSamples; i++)
+		{
+			offsetL = _mm_add_ps(offsetL, deltaL);
+			offsetR = _mm_add_ps(offsetR, deltaR);
+			_mm_storeu_ps(offsets + i * NUM_LINES, offsetL);
+			_mm_storeu_ps(offsets + i * NUM_LINES + NUM_LINES_PER_CHANNEL, offsetR);
+		}
+#endif
+		for (; i < numSamples; i++)
+		{
+			for (int line = 0; line < NUM_LINES; line++)
+			{
+				offsets[i * NUM_LINES + line] = offsetStart[line] + offsetDelta[line] * (i + 1);
+			}
+		}
+	}
+
+	// Reads both interpolation taps of the whole block for every line
+	inline void readTaps(const int numSamples)
+	{
+		for (int line = 0; line < NUM_LINES; line++)
+		{
+			const DelayLine *delayLine = lines[line];
+			const float *lineData = delayLine->getData();
+
+			for (int i = 0; i < numSamples; i++)
+			{
+				float offset = offsets[i * NUM_LINES + line];
+				int offsetInt = (int)offset;
+
+				// Sample i is written at the write position + i, the guard
+				// keeps the older tap and the tap after it in a row
+				const float *data = lineData + delayLine->getReadPosition(offsetInt + 1 - i);
+
+				// interpolate, see paper: http://www.stanford.edu/~dattorro/EffectDesignPart2.pdf
+				tap1[i * NUM_LINES + line] = data[1];
+				tap2[i * NUM_LINES + line] = data[0];
+				fracInverted[i * NUM_LINES + line] = 1.0f - (offset - offsetInt);
+			}
+		}
+	}
+
+	// The allpass interpolation recursion of all lines, one sample at a time
+	inline void processLines(const float *input, const int numSamples, const float feedback)
+	{
+		int i = 0;
+#if defined(COMBBANK_USE_SSE)
+		__m128 z1L = _mm_loadu_ps(z1);
+		__m128 z1R = _mm_loadu_ps(z1 + NUM_LINES_PER_CHANNEL);
+		const __m128 feedbackVector = _mm_set1_ps(feedback);
+		for (; i < numSamples; i++)
+		{
+			const int index = i * NUM_LINES;
+			const __m128 inputVector = _mm_set1_ps(input[i]);
+
+			// tap2 + (tap1 - z1) * (1 - frac)
+			__m128 outL = _mm_add_ps(_mm_loadu_ps(tap2 + index), _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(tap1 + index), z1L), _mm_loadu_ps(fracInverted + index)));
+			__m128 outR = _mm_add_ps(_mm_loadu_ps(tap2 + index + 4), _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(tap1 + index + 4), z1R), _mm_loadu_ps(fracInverted + index + 4)));
+			z1L = outL;
+			z1R = outR;
+
+			_mm_storeu_ps(output + index, outL);
+			_mm_storeu_ps(output + index + 4, outR);
+			_mm_storeu_ps(feedbackOutput + index, _mm_add_ps(inputVector, _mm_mul_ps(outL, feedbackVector)));
+			_mm_storeu_ps(feedbackOutput + index + 4, _mm_add_ps(inputVector, _mm_mul_ps(outR, feedbackVector)));
+		}
+		_mm_storeu_ps(z1, z1L);
+		_mm_storeu_ps(z1 + NUM_LINES_PER_CHANNEL, z1R);
+#endif
+		for (; i < numSamples; i++)
+		{
+			const int index = i * NUM_LINES;
+			for (int line = 0; line < NUM_LINES; line++)
+			{
+				float out = tap2[index + line] + (tap1[index + line] - z1[line]) * fracInverted[index + line];
+				z1[line] = out;
+				output[index + line] = out;
+				feedbackOutput[index + line] = input[i] + out * feedback;
+			}
+		}
+	}
+
+	inline void writeLines(const int numSamples)
+	{
+		for (int line = 0; line < NUM_LINES; line++)
+		{
+			float *lineData = lines[line]->getWritePointer();
+			for (int i = 0; i < numSamples; i++)
+			{
+				lineData[i] = feedbackOutput[i * NUM_LINES + line];
+			}
+			lines[line]->advance(numSamples);
+		}
+	}
+
+	// NoiseGenerator::tickFilteredNoise advanced by numSamples at once,
+	// returns [0..1]. The period is at least 22188 samples, so the triangle
+	// turns at most once per block. It stops at the turning point instead of
+	// overshooting, so the delays never get shorter than unmodulated.
+	inline float tickModulation(const int line, const int numSamples)
+	{
+		if (modulationValue[line] >= 1.0f)
+		{
+			getNextRandomPeriod(line, -1.0f);
+		}
+		if (modulationValue[line] <= 0.0f)
+		{
+			getNextRandomPeriod(line, 1.0f);
+		}
+		float start = modulationValue[line];
+		modulationValue[line] += modulationDelta[line] * numSamples;
+		if (modulationValue[line] > 1.0f) modulationValue[line] = 1.0f;
+		if (modulationValue[line] < 0.0f) modulationValue[line] = 0.0f;
+
+		// Exponential averager towards the mean of the block
+		float target = (start + modulationValue[line]) * 0.5f;
+		modulationFiltered[line] = target + (modulationFiltered[line] - target) * modulationDecay[numSamples];
+		return modulationFiltered[line];
+	}
+
+	inline void getNextRandomPeriod(const int line, const float sign)
+	{
+		randSeed[line] *= 16807;
+		float noise = (float)(randSeed[line] & 0x7FFFFFFF) * 4.6566129e-010f;
+		int randomPeriod = (int)(noise * 22768.0f) + 22188;
+		modulationDelta[line] = sign / (float)randomPeriod;
+	}
+};
+#endif
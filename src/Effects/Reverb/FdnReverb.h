@@ -0,0 +1,402 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__FdnReverb_h)
+#define __FdnReverb_h
+
+#include "AllPassFilter.h"
+#include "PreDelay.h"
+#include "Filter.h"
+#include "Math.h"
+#include "../../Engine/AudioUtils.h"
+#include "../../Engine/DelayLine.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FDNREVERB_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Feedback delay network with 8 modulated delay lines and a Householder
+// feedback matrix. The left input feeds the first 4 lines and the right input
+// the last 4. All lines are longer than a block, so every tap of a block is
+// read before the block writes the lines, and the matrix runs on all 8 lines
+// as two SSE vectors of 4.
+class FdnReverb
+{
+public:
+	static const int NUM_LINES = 8;
+	static const int MAX_BLOCK_SIZE = 64;
+
+private:
+	static const int MAX_PRE_DELAY_MS = 1000;
+	static const int MAX_DELAY_MS = 82;
+	static const int DIFFUSERS = 2;
+
+	DelayLine *lines[NUM_LINES];
+	int lineLength[NUM_LINES];
+	float lineDelay[NUM_LINES];
+
+	// Decay per pass through a line
+	float lineGain[NUM_LINES];
+
+	// Delay modulation, a triangle per line with slightly different rates
+	float modulationPhase[NUM_LINES];
+	float modulationInc[NUM_LINES];
+	float modulationDepth;
+
+	// Block buffers, sample major so one sample of all lines is contiguous
+	float taps[MAX_BLOCK_SIZE * NUM_LINES];
+	float feedbackOutput[MAX_BLOCK_SIZE * NUM_LINES];
+	float inputL[MAX_BLOCK_SIZE];
+	float inputR[MAX_BLOCK_SIZE];
+
+	PreDelay *preDelayL;
+	PreDelay *preDelayR;
+
+	AllPassFilter *diffusersL[DIFFUSERS];
+	AllPassFilter *diffusersR[DIFFUSERS];
+
+	Filter *filterLowCutL;
+	Filter *filterLowCutR;
+	Filter *filterHighCutL;
+	Filter *filterHighCutR;
+
+	float referenceLength;
+	float decayTime;
+
+	float highCut;
+	float lowCut;
+
+	AudioUtils audioUtils;
+
+public:
+	FdnReverb(int sampleRate)
+	{
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			lines[i] = new DelayLine(getLineLength(i, (float)sampleRate), MAX_BLOCK_SIZE);
+		}
+
+		preDelayL = new PreDelay((float)MAX_PRE_DELAY_MS, sampleRate);
+		preDelayR = new PreDelay((float)MAX_PRE_DELAY_MS, sampleRate);
+
+		diffusersL[0] = new AllPassFilter(4.7f, 0.68f, sampleRate);
+		diffusersL[1] = new AllPassFilter(3.6f, 0.68f, sampleRate);
+		diffusersR[0] = new AllPassFilter(4.9f, 0.68f, sampleRate);
+		diffusersR[1] = new AllPassFilter(3.4f, 0.68f, sampleRate);
+
+		filterLowCutL = new Filter(sampleRate);
+		filterLowCutR = new Filter(sampleRate);
+		filterHighCutL = new Filter(sampleRate);
+		filterHighCutR = new Filter(sampleRate);
+
+		highCut = 1.0f;
+		lowCut = 0.0f;
+		decayTime = 0.5f;
+		setSampleRate((float)sampleRate);
+		setDecayTime(0.5f);
+	}
+
+	~FdnReverb()
+	{
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			delete lines[i];
+		}
+
+		delete preDelayL;
+		delete preDelayR;
+
+		for (int i = 0; i < DIFFUSERS; i++)
+		{
+			delete diffusersL[i];
+			delete diffusersR[i];
+		}
+
+		delete filterLowCutL;
+		delete filterLowCutR;
+		delete filterHighCutL;
+		delete filterHighCutR;
+	}
+
+	// Reuses the delay lines and starts from silence, false if the delay
+	// lines are too short for the sample rate
+	bool setSampleRate(float sampleRate)
+	{
+		bool isFitting = true;
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			isFitting &= getLineLength(i, sampleRate) <= lines[i]->getCapacity();
+		}
+		for (int i = 0; i < DIFFUSERS; i++)
+		{
+			isFitting &= diffusersL[i]->setSampleRate(sampleRate);
+			isFitting &= diffusersR[i]->setSampleRate(sampleRate);
+		}
+		if (!isFitting)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			lineDelay[i] = getLineDelay(i, sampleRate);
+			lineLength[i] = getLineLength(i, sampleRate);
+			lines[i]->setLength(lineLength[i]);
+
+			modulationPhase[i] = (float)i / NUM_LINES;
+			modulationInc[i] = (0.3f + 0.07f * i) / sampleRate;
+		}
+		modulationDepth = getModulationDepth(sampleRate);
+		referenceLength = MAX_DELAY_MS * sampleRate / 1000;
+		updateLineGains();
+
+		preDelayL->setSampleRate(sampleRate);
+		preDelayR->setSampleRate(sampleRate);
+
+		filterLowCutL->setSampleRate(sampleRate);
+		filterLowCutR->setSampleRate(sampleRate);
+		filterHighCutL->setSampleRate(sampleRate);
+		filterHighCutR->setSampleRate(sampleRate);
+		return true;
+	}
+
+	// Same decay as Reverb, the longest line loses as much per pass as a comb
+	void setDecayTime(float decayTime)
+	{
+		this->decayTime = audioUtils.getLogScaledValueInverted(decayTime) * 0.99f;
+		updateLineGains();
+	}
+
+	void setPreDelay(float preDelayTime)
+	{
+		preDelayL->setDelay(audioUtils.getLogScaledValue(preDelayTime));
+		preDelayR->setDelay(audioUtils.getLogScaledValue(preDelayTime));
+	}
+
+	void setLowCut(float value)
+	{
+		this->lowCut = audioUtils.getLogScaledValue(value);
+	}
+
+	void setHighCut(float value)
+	{
+		this->highCut = audioUtils.getLogScaledValue(value);
+	}
+
+	// Non audio thread, grows the pre delay lines if needed.
+	// Returns true if swapBuffers has to be called.
+	bool allocateBuffers()
+	{
+		bool isSwapPending = preDelayL->allocateBuffers();
+		isSwapPending |= preDelayR->allocateBuffers();
+		return isSwapPending;
+	}
+
+	// Call with the audio thread locked
+	void swapBuffers()
+	{
+		preDelayL->swapBuffers();
+		preDelayR->swapBuffers();
+	}
+
+	// Non audio thread, after swapBuffers
+	void freeBuffers()
+	{
+		preDelayL->freeBuffers();
+		preDelayR->freeBuffers();
+	}
+
+	// All input values [0..1], processes in place
+	inline void process(float* sampleL, float* sampleR, int numSamples)
+	{
+		while (numSamples > 0)
+		{
+			int blockSize = numSamples < MAX_BLOCK_SIZE ? numSamples : MAX_BLOCK_SIZE;
+			processBlock(sampleL, sampleR, blockSize);
+			sampleL += blockSize;
+			sampleR += blockSize;
+			numSamples -= blockSize;
+		}
+	}
+
+private:
+	// Same spread as the comb lines of Reverb, but 8 of them
+	float getLineDelay(const int line, const float sampleRate)
+	{
+		float delayTime = MAX_DELAY_MS / powf(2.0f, (float)(NUM_LINES - 1 - line) / NUM_LINES);
+		return (float)audioUtils.getNextNearPrime((int)(delayTime * sampleRate / 1000));
+	}
+
+	// Up to 0.5ms of modulation
+	float getModulationDepth(const float sampleRate)
+	{
+		return sampleRate * 0.0005f;
+	}
+
+	int getLineLength(const int line, const float sampleRate)
+	{
+		return (int)(getLineDelay(line, sampleRate) + getModulationDepth(sampleRate)) + 2;
+	}
+
+	void updateLineGains()
+	{
+		float feedback = decayTime * 0.998f;
+		for (int i = 0; i < NUM_LINES; i++)
+		{
+			lineGain[i] = powf(feedback, lineDelay[i] / referenceLength);
+		}
+	}
+
+	inline void processBlock(float* sampleL, float* sampleR, const int numSamples)
+	{
+		for (int i = 0; i < numSamples; i++)
+		{
+			inputL[i] = sampleL[i] * 0.25f;
+			inputR[i] = sampleR[i] * 0.25f;
+		}
+		preDelayL->process(inputL, numSamples);
+		preDelayR->process(inputR, numSamples);
+		for (int i = 0; i < numSamples; i++)
+		{
+			filterLowCutL->process(&inputL[i], lowCut, false);
+			filterLowCutR->process(&inputR[i], lowCut, false);
+			filterHighCutL->process(&inputL[i], highCut, true);
+			filterHighCutR->process(&inputR[i], highCut, true);
+		}
+
+		for (int i = 0; i < DIFFUSERS; i++)
+		{
+			diffusersL[i]->process(inputL, numSamples);
+			diffusersR[i]->process(inputR, numSamples);
+		}
+
+		readTaps(numSamples);
+		processMatrix(numSamples);
+		writeLines(numSamples);
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			const float *tap = taps + i * NUM_LINES;
+			sampleL[i] = (tap[0] - tap[1] + tap[2] - tap[3]) * 2.0f;
+			sampleR[i] = (tap[4] - tap[5] + tap[6] - tap[7]) * 2.0f;
+		}
+	}
+
+	// Linear interpolated taps of the whole block for every line
+	inline void readTaps(const int numSamples)
+	{
+		for (int line = 0; line < NUM_LINES; line++)
+		{
+			const float *lineData = lines[line]->getData();
+			const int length = lineLength[line];
+			const float delay = lineDelay[line];
+			float phase = modulationPhase[line];
+			const float inc = modulationInc[line];
+			int position = lines[line]->getReadPosition(0);
+
+			for (int i = 0; i < numSamples; i++)
+			{
+				// Triangle [0..1]
+				float triangle = phase < 0.5f ? 2.0f * phase : 2.0f - 2.0f * phase;
+				phase += inc;
+				if (phase >= 1.0f) phase -= 1.0f;
+
+				float readPosition = (float)position - delay - modulationDepth * triangle;
+				if (readPosition < 0.0f) readPosition += length;
+				int readPtr1 = (int)readPosition;
+				if (readPtr1 >= length) readPtr1 -= length;
+				float frac = readPosition - readPtr1;
+
+				// The guard keeps the next sample in a row
+				const float *data = lineData + readPtr1;
+				taps[i * NUM_LINES + line] = data[0] + (data[1] - data[0]) * frac;
+
+				if (++position >= length) position = 0;
+			}
+			modulationPhase[line] = phase;
+		}
+	}
+
+	// Householder feedback: line - 2 / NUM_LINES * sum of all lines, then the
+	// decay per line and the input
+	inline void processMatrix(const int numSamples)
+	{
+		const float householder = 2.0f / NUM_LINES;
+		int i = 0;
+#if defined(FDNREVERB_USE_SSE)
+		const __m128 gainL = _mm_loadu_ps(lineGain);
+		const __m128 gainR = _mm_loadu_ps(lineGain + 4);
+		const __m128 signs = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+		for (; i < numSamples; i++)
+		{
+			const int index = i * NUM_LINES;
+			__m128 tapsL = _mm_loadu_ps(taps + index);
+			__m128 tapsR = _mm_loadu_ps(taps + index + 4);
+
+			// Horizontal sum of all 8 lines in every element
+			__m128 sum = _mm_add_ps(tapsL, tapsR);
+			sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+			sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+			sum = _mm_mul_ps(sum, _mm_set1_ps(householder));
+
+			__m128 inL = _mm_mul_ps(_mm_set1_ps(inputL[i]), signs);
+			__m128 inR = _mm_mul_ps(_mm_set1_ps(inputR[i]), signs);
+
+			_mm_storeu_ps(feedbackOutput + index, _mm_add_ps(inL, _mm_mul_ps(_mm_sub_ps(tapsL, sum), gainL)));
+			_mm_storeu_ps(feedbackOutput + index + 4, _mm_add_ps(inR, _mm_mul_ps(_mm_sub_ps(tapsR, sum), gainR)));
+		}
+#endif
+		for (; i < numSamples; i++)
+		{
+			const int index = i * NUM_LINES;
+			float sum = 0.0f;
+			for (int line = 0; line < NUM_LINES; line++)
+			{
+				sum += taps[index + line];
+			}
+			sum *= householder;
+
+			for (int line = 0; line < NUM_LINES; line++)
+			{
+				float input = line < NUM_LINES / 2 ? inputL[i] : inputR[i];
+				if (line & 1) input = -input;
+				feedbackOutput[index + line] = input + (taps[index + line] - sum) * lineGain[line];
+			}
+		}
+	}
+
+	inline void writeLines(const int numSamples)
+	{
+		for (int line = 0; line < NUM_LINES; line++)
+		{
+			float *lineData = lines[line]->getWritePointer();
+			for (int i = 0; i < numSamples; i++)
+			{
+				lineData[i] = feedbackOutput[i * NUM_LINES + line];
+			}
+			lines[line]->advance(numSamples);
+		}
+	}
+};
+#endif
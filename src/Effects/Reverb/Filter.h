@@ -41,6 +41,12 @@ class Filter
 	Filter(float sampleRate)
 	{
 		Pi = 3.141592653f;
+		setSampleRate(sampleRate);
+	}
+
+	// Starts from silence
+	void setSampleRate(float sampleRate)
+	{
 		y1 = y2 = y3 = y4 = oldx = oldy1 = oldy2 = oldy3 = 0.0f;
 
 		if (sampleRate <= 0.0f) sampleRate = 44100.0f;
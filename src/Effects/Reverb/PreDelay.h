@@ -0,0 +1,174 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__PreDelay_h)
+#define __PreDelay_h
+
+#include "../../Engine/DelayLine.h"
+
+// Pre delay of the reverbs, a plain delay line that is only as long as the
+// pre delay has been so far. A longer line is allocated by allocateBuffers
+// on a non audio thread, until swapBuffers has installed it the delay is
+// limited to the current line. The new line takes over the history of the
+// old one, so the delay moves on without a dropout. Without pre delay
+// nothing is processed.
+class PreDelay
+{
+public:
+	static const int MAX_BLOCK_SIZE = 64;
+
+private:
+	DelayLine *delayLine;
+
+	// Allocated line waiting for swapBuffers, then the replaced one
+	DelayLine *pendingDelayLine;
+	bool isSwapPending;
+
+	// In milliseconds
+	float maxDelayTime;
+
+	// [0..1] of the max delay
+	float delayValue;
+
+	// In samples
+	int maxDelay;
+	int delay;
+
+	// The line missed samples while the pre delay was off
+	bool isCleared;
+
+public:
+	// maxDelayTime in milliseconds
+	PreDelay(float maxDelayTime, int sampleRate)
+	{
+		this->maxDelayTime = maxDelayTime;
+		maxDelay = (int)(maxDelayTime * sampleRate / 1000.0f);
+		delayValue = 0.0f;
+		delay = 0;
+		delayLine = 0;
+		pendingDelayLine = 0;
+		isSwapPending = false;
+		isCleared = true;
+	}
+
+	~PreDelay()
+	{
+		delete delayLine;
+		delete pendingDelayLine;
+	}
+
+	// [0..1] of the max delay
+	void setDelay(float delay)
+	{
+		delayValue = delay;
+		this->delay = (int)(delay * maxDelay);
+	}
+
+	// Keeps the line and starts from silence, allocateBuffers grows it if
+	// the delay gets longer than the line at the new sample rate
+	void setSampleRate(float sampleRate)
+	{
+		maxDelay = (int)(maxDelayTime * sampleRate / 1000.0f);
+		setDelay(delayValue);
+		if (delayLine != 0)
+		{
+			delayLine->clear();
+		}
+		isCleared = true;
+	}
+
+	// Non audio thread, returns true if swapBuffers has to be called
+	bool allocateBuffers()
+	{
+		if (!isSwapPending && delay > 0)
+		{
+			int length = delay + MAX_BLOCK_SIZE;
+			if (delayLine == 0 || delayLine->getLength() < length)
+			{
+				// Grow in steps of an eighth of the max delay, so sweeping
+				// the pre delay up does not allocate all the time
+				int step = maxDelay / 8 + 1;
+				length = (delay / step + 1) * step;
+				if (length > maxDelay) length = maxDelay;
+				pendingDelayLine = new DelayLine(length + MAX_BLOCK_SIZE, MAX_BLOCK_SIZE);
+				isSwapPending = true;
+			}
+		}
+		return isSwapPending;
+	}
+
+	// Call with the audio thread locked, copies the line and exchanges pointers
+	void swapBuffers()
+	{
+		if (isSwapPending)
+		{
+			if (delayLine != 0)
+			{
+				pendingDelayLine->copyHistory(delayLine);
+			}
+			DelayLine *previous = delayLine;
+			delayLine = pendingDelayLine;
+			pendingDelayLine = previous;
+			isSwapPending = false;
+		}
+	}
+
+	// Non audio thread, after swapBuffers
+	void freeBuffers()
+	{
+		if (!isSwapPending)
+		{
+			delete pendingDelayLine;
+			pendingDelayLine = 0;
+		}
+	}
+
+	// In place, at most MAX_BLOCK_SIZE samples
+	inline void process(float *samples, const int numSamples)
+	{
+		if (delay <= 0 || delayLine == 0)
+		{
+			// Silence instead of what was there when the pre delay comes back
+			if (!isCleared && delayLine != 0)
+			{
+				delayLine->clear();
+				isCleared = true;
+			}
+			return;
+		}
+		isCleared = false;
+
+		int maxLineDelay = delayLine->getLength() - numSamples;
+		int lineDelay = delay < maxLineDelay ? delay : maxLineDelay;
+
+		// The oldest sample of the block is numSamples + delay old once
+		// the block is written, the block is read from there in a row
+		delayLine->write(samples, numSamples);
+		const float *data = delayLine->getData() + delayLine->getReadPosition(numSamples + lineDelay);
+		for (int i = 0; i < numSamples; i++)
+		{
+			samples[i] = data[i];
+		}
+	}
+};
+#endif
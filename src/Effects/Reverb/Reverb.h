@@ -25,8 +25,8 @@
 #define __Reverb_h
 
 #include "AllPassFilter.h"
-#include "CombFilter.h"
-#include "NoiseGenerator.h"
+#include "PreDelay.h"
+#include "CombBank.h"
 #include "Filter.h"
 #include "Math.h"
 #include "../../Engine/AudioUtils.h"
@@ -41,15 +41,9 @@ class Reverb
 	float* reflectionGains;
 	float* reflectionDelays;
 
-	CombFilter *combFiltersPreDelayL;
-	CombFilter *combFiltersPreDelayR;
+	PreDelay *preDelay;
 
-	CombFilter **combFiltersL;
-	CombFilter **combFiltersR;
-	NoiseGenerator **noiseGeneratorAllPassL;
-	NoiseGenerator **noiseGeneratorAllPassR;
-	NoiseGenerator **noiseGeneratorDelayL;
-	NoiseGenerator **noiseGeneratorDelayR;
+	CombBank *combBank;
 	AllPassFilter **allPassFiltersL;
 	AllPassFilter **allPassFiltersR;
 
@@ -63,13 +57,15 @@ class Reverb
     Filter *filterHighCut;
 
 	float decayTime;
-	float preDelayTime;
 	bool stereoMode;
 	float modulationIntensity;
 
     float highCut;
     float lowCut;
 
+	// Filtered mono input of the comb bank
+	float input[CombBank::MAX_BLOCK_SIZE];
+
 	AudioUtils audioUtils;
 
 public:
@@ -77,15 +73,10 @@ class Reverb
 	{
 		createDelaysAndCoefficients(DELAY_LINES_COMB + DELAY_LINES_ALLPASS, 82.0f);
 
-		combFiltersPreDelayL = new CombFilter((float)MAX_PRE_DELAY_MS, 0.0f, sampleRate);
-		combFiltersPreDelayR = new CombFilter((float)MAX_PRE_DELAY_MS, 0.0f, sampleRate);
+		preDelay = new PreDelay((float)MAX_PRE_DELAY_MS, sampleRate);
 
-		combFiltersL = new CombFilter *[DELAY_LINES_COMB];
-		combFiltersR = new CombFilter *[DELAY_LINES_COMB];
-		noiseGeneratorAllPassL = new NoiseGenerator *[DELAY_LINES_COMB];
-		noiseGeneratorAllPassR = new NoiseGenerator *[DELAY_LINES_COMB];
-		noiseGeneratorDelayL = new NoiseGenerator *[DELAY_LINES_COMB];
-		noiseGeneratorDelayR = new NoiseGenerator *[DELAY_LINES_COMB];
+		// Left lines first, then the right lines
+		float combDelays[CombBank::NUM_LINES];
 		float stereoSpreadValue = 0.008f;
 		float stereoSpreadSign = 1.0f;
 		for (int i = 0; i < DELAY_LINES_COMB; i++)
@@ -93,20 +84,17 @@ class Reverb
 			float stereoSpreadFactor = 1.0f + stereoSpreadValue;
 			if (stereoSpreadSign > 0.0f)
 			{
-				combFiltersL[i] = new CombFilter(reflectionDelays[i] * stereoSpreadFactor, reflectionGains[i], sampleRate);
-				combFiltersR[i] = new CombFilter(reflectionDelays[i], reflectionGains[i], sampleRate);
+				combDelays[i] = reflectionDelays[i] * stereoSpreadFactor;
+				combDelays[i + DELAY_LINES_COMB] = reflectionDelays[i];
 			}
 			else
 			{
-				combFiltersL[i] = new CombFilter(reflectionDelays[i], reflectionGains[i], sampleRate);
-				combFiltersR[i] = new CombFilter(reflectionDelays[i] * stereoSpreadFactor, reflectionGains[i], sampleRate);
+				combDelays[i] = reflectionDelays[i];
+				combDelays[i + DELAY_LINES_COMB] = reflectionDelays[i] * stereoSpreadFactor;
 			}
 			stereoSpreadSign *= -1.0f;
-			noiseGeneratorAllPassL[i] = new NoiseGenerator(sampleRate);
-			noiseGeneratorAllPassR[i] = new NoiseGenerator(sampleRate);
-			noiseGeneratorDelayL[i] = new NoiseGenerator(sampleRate);
-			noiseGeneratorDelayR[i] = new NoiseGenerator(sampleRate);
 		}
+		combBank = new CombBank(combDelays, sampleRate);
 		preAllPassFilterL = new AllPassFilter(14.0f,  0.68f, sampleRate);
 		preAllPassFilterR = new AllPassFilter(15.0f,  0.68f, sampleRate);
 
@@ -125,7 +113,6 @@ class Reverb
         this->filterHighCut = new Filter(sampleRate);
 
 		decayTime = 0.5f;
-		preDelayTime = 0.0f;
 		modulationIntensity = 0.12f;
 		stereoMode = true;
 
@@ -135,28 +122,29 @@ class Reverb
 
 	~Reverb()
 	{
-		delete reflectionGains;
-		delete reflectionDelays;
-
-		delete combFiltersPreDelayL;
-		delete combFiltersPreDelayR;
+		delete[] reflectionGains;
+		delete[] reflectionDelays;
 
-		delete combFiltersL;
-		delete combFiltersR;
+		delete preDelay;
 
-		delete allPassFiltersL;
-		delete allPassFiltersR;
+		delete combBank;
 
-		delete noiseGeneratorAllPassL;
-		delete noiseGeneratorAllPassR;
-		delete noiseGeneratorDelayL;
-		delete noiseGeneratorDelayR;
+		for (int i = 0; i < DELAY_LINES_ALLPASS; i++)
+		{
+			delete allPassFiltersL[i];
+			delete allPassFiltersR[i];
+		}
+		delete[] allPassFiltersL;
+		delete[] allPassFiltersR;
 
 		delete preAllPassFilterL;
 		delete preAllPassFilterR;
 
 		delete postAllPassFilterL;
 		delete postAllPassFilterR;
+
+		delete filterLowCut;
+		delete filterHighCut;
 	}
 
 
@@ -167,7 +155,7 @@ class Reverb
 
 	void setPreDelay(float preDelayTime)
 	{
-		this->preDelayTime = audioUtils.getLogScaledValue(preDelayTime);
+		preDelay->setDelay(audioUtils.getLogScaledValue(preDelayTime));
 	}
 
 	void setStereoMode(bool stereoMode)
@@ -185,49 +173,87 @@ class Reverb
         this->highCut = audioUtils.getLogScaledValue(value);
 	}
 
-	// All input values [0..1]
-	inline void process(float* sampleL, float* sampleR)
+	// Reuses the delay lines and starts from silence, false if the delay
+	// lines are too short for the sample rate
+	bool setSampleRate(float sampleRate)
 	{
-		float revR;
-		float revL;
+		bool isFitting = combBank->setSampleRate(sampleRate);
+		isFitting &= preAllPassFilterL->setSampleRate(sampleRate);
+		isFitting &= preAllPassFilterR->setSampleRate(sampleRate);
+		isFitting &= postAllPassFilterL->setSampleRate(sampleRate);
+		isFitting &= postAllPassFilterR->setSampleRate(sampleRate);
+		for (int i = 0; i < DELAY_LINES_ALLPASS; i++)
+		{
+			isFitting &= allPassFiltersL[i]->setSampleRate(sampleRate);
+			isFitting &= allPassFiltersR[i]->setSampleRate(sampleRate);
+		}
+		if (!isFitting)
+		{
+			return false;
+		}
 
-		revL = (*sampleL + *sampleR) * 0.25f; 
-		revL = combFiltersPreDelayL->process(revL, 0.0f, 0.0f, preDelayTime);
-		filterLowCut->process(&revL, lowCut, false);
-		filterHighCut->process(&revL, highCut, true);
-		revR = revL;
+		preDelay->setSampleRate(sampleRate);
+        filterLowCut->setSampleRate(sampleRate);
+        filterHighCut->setSampleRate(sampleRate);
+		return true;
+	}
 
-		// ----------------- Comb Filter --------------------
-		float outL = 0.0f;
-		float outR = 0.0f;
+	// Non audio thread, grows the pre delay line if needed.
+	// Returns true if swapBuffers has to be called.
+	bool allocateBuffers()
+	{
+		return preDelay->allocateBuffers();
+	}
 
-		float scaledRoomSize = decayTime * 0.998f;
-		float sign = 1.0f;
-		for (int i = 0; i < DELAY_LINES_COMB; i++)
-		{ 
-			outL += sign * combFiltersL[i]->processInterpolated(revL, 0.0f, scaledRoomSize, scaledRoomSize + 0.012f * noiseGeneratorDelayL[i]->tickFilteredNoise());
-			outR += sign * combFiltersR[i]->processInterpolated(revR, 0.0f, scaledRoomSize, scaledRoomSize + 0.012f * noiseGeneratorDelayR[i]->tickFilteredNoise());
-			sign *= -1.0f;
+	// Call with the audio thread locked
+	void swapBuffers()
+	{
+		preDelay->swapBuffers();
+	}
+
+	// Non audio thread, after swapBuffers
+	void freeBuffers()
+	{
+		preDelay->freeBuffers();
+	}
+
+	// All input values [0..1], processes in place
+	inline void process(float* sampleL, float* sampleR, int numSamples)
+	{
+		while (numSamples > 0)
+		{
+			int blockSize = numSamples < CombBank::MAX_BLOCK_SIZE ? numSamples : CombBank::MAX_BLOCK_SIZE;
+			processBlock(sampleL, sampleR, blockSize);
+			sampleL += blockSize;
+			sampleR += blockSize;
+			numSamples -= blockSize;
 		}
+	}
 
-		// ----------------- Pre AllPass --------------------
-		//outL += 0.5f * preAllPassFilterL->processInterpolated(revL, 0.9f + 0.1f * noiseGeneratorAllPassL[0]->tickFilteredNoise(), 0.68f, true);
-		//outR += 0.5f * preAllPassFilterR->processInterpolated(revR, 0.9f + 0.1f * noiseGeneratorAllPassR[0]->tickFilteredNoise(), 0.68f, true);
+private:
+	inline void processBlock(float* sampleL, float* sampleR, const int numSamples)
+	{
+		for (int i = 0; i < numSamples; i++)
+		{
+			input[i] = (sampleL[i] + sampleR[i]) * 0.25f; 
+		}
+		preDelay->process(input, numSamples);
+		for (int i = 0; i < numSamples; i++)
+		{
+			filterLowCut->process(&input[i], lowCut, false);
+			filterHighCut->process(&input[i], highCut, true);
+		}
 
-		//// ----------------- Post AllPass --------------------
-		//outL += 0.45f * postAllPassFilterL->processInterpolated(revL, 0.85f + 0.15f * noiseGeneratorAllPassL[1]->tickFilteredNoise(), 0.68f, true);
-		//outR += 0.45f * postAllPassFilterR->processInterpolated(revR, 0.85f + 0.15f * noiseGeneratorAllPassR[1]->tickFilteredNoise(), 0.68f, true);
+		// ----------------- Comb Filter --------------------
+		float scaledRoomSize = decayTime * 0.998f;
+		combBank->process(input, sampleL, sampleR, numSamples, scaledRoomSize, scaledRoomSize);
 
 		// ----------------- AllPass Filter ------------------
 		for (int i = 0; i < DELAY_LINES_ALLPASS; i++)
 		{
-			outL = allPassFiltersL[i]->process(outL);
-			outR = allPassFiltersR[i]->process(outR);
+			allPassFiltersL[i]->process(sampleL, numSamples);
+			allPassFiltersR[i]->process(sampleR, numSamples);
 		}
-
-		// ----------------- Write to output / Stereo --------
-		*sampleL = outL;
-		*sampleR = outR;
 	}
 
 	void createDelaysAndCoefficients(int numlines, float delayLength)
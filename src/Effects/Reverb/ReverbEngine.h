@@ -25,36 +25,122 @@
 #define __ReverbEngine_h
 
 #include "Reverb.h"
+#include "FdnReverb.h"
 #include "AudioUtils.h"
 #include "Params.h"
 #include "NoiseGenerator.h"
+#include "../../Engine/TailDetector.h"
 
+// The reverb of the selected mode is allocated by allocateBuffers on a non
+// audio thread when the wet level goes up, and released after it has been
+// idle for the release time. Until swapBuffers has installed it only the dry
+// signal passes.
 class ReverbEngine 
 {
 public:
 	float *param;
 	Reverb* reverb;
+	FdnReverb* fdnReverb;
+
+	// Feedback delay network instead of the comb reverb
+	bool isFdnEnabled;
 
 	NoiseGenerator *noiseGenerator;
+	TailDetector *tailDetector;
 
 	float dry;
 	float wet;
 	float stereoWidth;
 
+	static const int MAX_BLOCK_SIZE = CombBank::MAX_BLOCK_SIZE;
+
+	float drySampleL[MAX_BLOCK_SIZE];
+	float drySampleR[MAX_BLOCK_SIZE];
+	float reverbL[MAX_BLOCK_SIZE];
+	float reverbR[MAX_BLOCK_SIZE];
+
 	AudioUtils audioUtils;
 
+private:
+	// Allocated or released reverbs waiting for swapBuffers, then freed
+	Reverb* pendingReverb;
+	FdnReverb* pendingFdnReverb;
+	bool isSwapPending;
+
+	// What allocateBuffers has to do, decided by updateAllocation
+	bool isAllocationNeeded;
+	bool isReleaseNeeded;
+	bool isFdnAllocation;
+	float allocationPreDelay;
+
+	float sampleRate;
+	float bufferSampleRate;
+	float pendingSampleRate;
+
+	// Samples the reverb has been bypassed or silent
+	int idleSamples;
+	int releaseSamples;
+	float releaseTime;
+
+	// Parameter values [0..1]. The setters only cache them, they are applied
+	// to the reverbs on the audio thread, which the timer cannot free them on.
+	float decayTime;
+	float preDelay;
+	float lowCut;
+	float highCut;
+	float stereoMode;
+	bool isParameterChanged;
+
+public:
 	ReverbEngine(float sampleRate) 
 	{
 		Params *params= new Params();
 		this->param= params->parameters;
-		initialize(sampleRate);
+
+		reverb = 0;
+		fdnReverb = 0;
+		pendingReverb = 0;
+		pendingFdnReverb = 0;
+		isSwapPending = false;
+		isAllocationNeeded = false;
+		isReleaseNeeded = false;
+		isFdnAllocation = false;
+		allocationPreDelay = 0.0f;
+		bufferSampleRate = 0.0f;
+		pendingSampleRate = 0.0f;
+		isFdnEnabled = false;
+
+		decayTime = 0.5f;
+		preDelay = 0.0f;
+		lowCut = 0.0f;
+		highCut = 1.0f;
+		stereoMode = 1.0f;
+		isParameterChanged = false;
+
+		noiseGenerator = new NoiseGenerator(sampleRate);
+
+		// Max pre delay plus the longest comb and allpass lines
+		tailDetector = new TailDetector((int)(sampleRate * 1.2f));
+
+		dry = 1.0f;
+		wet = 0.5f;
+		stereoWidth = 1.0f;
+
+		this->sampleRate = sampleRate;
+		idleSamples = 0;
+		releaseSamples = 0;
+		setReleaseTime(10.0f);
 	}
 
 	~ReverbEngine()
 	{
 		delete reverb;
+		delete fdnReverb;
+		delete pendingReverb;
+		delete pendingFdnReverb;
 
 		delete noiseGenerator;
+		delete tailDetector;
 	}
 
 	void setDry(float dry)
@@ -69,22 +155,26 @@ class ReverbEngine
 
 	void setDecayTime(float decayTime)
 	{
-		reverb->setDecayTime(decayTime);
+		this->decayTime = decayTime;
+		isParameterChanged = true;
 	}
 
 	void setPreDelay(float preDelay)
 	{
-		reverb->setPreDelay(preDelay);
+		this->preDelay = preDelay;
+		isParameterChanged = true;
 	}
 
 	void setLowCut(float value)
 	{
-		reverb->setLowCut(value);
+		this->lowCut = value;
+		isParameterChanged = true;
 	}
 
 	void setHighCut(float value)
 	{
-		reverb->setHighCut(value);
+		this->highCut = value;
+		isParameterChanged = true;
 	}
 
 	void setStereoWidth(float stereoWidth)
@@ -94,46 +184,269 @@ class ReverbEngine
 
 	void setStereoMode(float stereoMode)
 	{
-		reverb->setStereoMode(stereoMode > 0.0f ? true : false);
+		this->stereoMode = stereoMode;
+		isParameterChanged = true;
 	}
 
+	void setMode(float mode)
+	{
+		this->isFdnEnabled = mode > 0.0f;
+	}
+
+	// Reuses the installed reverb if its delay lines are long enough for the
+	// sample rate, otherwise it is reallocated by the next allocateBuffers
 	void setSampleRate(float sampleRate)
 	{
-		initialize(sampleRate);
+		this->sampleRate = sampleRate;
+		tailDetector->setHoldSamples((int)(sampleRate * 1.2f));
+		setReleaseTime(releaseTime);
+		if (isAllocated() && !isSwapPending)
+		{
+			bool isFitting = true;
+			if (reverb) isFitting &= reverb->setSampleRate(sampleRate);
+			if (fdnReverb) isFitting &= fdnReverb->setSampleRate(sampleRate);
+			if (isFitting)
+			{
+				bufferSampleRate = sampleRate;
+				isParameterChanged = true;
+			}
+		}
 	}
 
-	void initialize(float sampleRate)
+	// Seconds the reverb is kept after it went idle
+	void setReleaseTime(float seconds)
 	{
-		reverb = new Reverb((int)sampleRate);
-		noiseGenerator = new NoiseGenerator(sampleRate);
+		bool isIdle = idleSamples >= releaseSamples;
+		releaseTime = seconds;
+		releaseSamples = (int)(seconds * sampleRate);
+		if (isIdle) idleSamples = releaseSamples;
+	}
 
-		dry = 1.0f;
-		wet = 0.5f;
-		stereoWidth = 1.0f;
+	bool isAllocated()
+	{
+		return reverb != 0 || fdnReverb != 0;
 	}
 
-	void process(float *sampleL, float *sampleR) 
+	// Call with the audio thread locked, reads the state the audio thread
+	// changes and decides what allocateBuffers has to do.
+	// isUsed is false if process is not called at all.
+	void updateAllocation(bool isUsed)
 	{
-        if (wet > 0.0f)
-        {
-		    float noise = noiseGenerator->tickNoise() * 0.000000001f;
+		isAllocationNeeded = false;
+		isReleaseNeeded = false;
+		if (!isSwapPending)
+		{
+			bool isInUse = isUsed && (wet > 0.0f || idleSamples < releaseSamples);
+			if (isInUse && !isCurrent())
+			{
+				pendingSampleRate = sampleRate;
+				isFdnAllocation = isFdnEnabled;
+				allocationPreDelay = preDelay;
+				isAllocationNeeded = true;
+			}
+			else if (!isInUse && isAllocated())
+			{
+				isReleaseNeeded = true;
+			}
+		}
+	}
+
+	// Non audio thread after updateAllocation, allocates the reverb of the
+	// selected mode or schedules the release. The other parameters are set
+	// by the first process after swapBuffers.
+	// Returns true if swapBuffers has to be called.
+	bool allocateBuffers()
+	{
+		if (isAllocationNeeded)
+		{
+			// Sized for the pre delay right away
+			if (isFdnAllocation)
+			{
+				pendingFdnReverb = new FdnReverb((int)pendingSampleRate);
+				pendingFdnReverb->setPreDelay(allocationPreDelay);
+				pendingFdnReverb->allocateBuffers();
+				pendingFdnReverb->swapBuffers();
+			}
+			else
+			{
+				pendingReverb = new Reverb((int)pendingSampleRate);
+				pendingReverb->setPreDelay(allocationPreDelay);
+				pendingReverb->allocateBuffers();
+				pendingReverb->swapBuffers();
+			}
+			isSwapPending = true;
+		}
+		else if (isReleaseNeeded)
+		{
+			isSwapPending = true;
+		}
+		isAllocationNeeded = false;
+		isReleaseNeeded = false;
+
+		// The pre delay of the installed reverb grows with its setting
+		bool isPreDelaySwapPending = false;
+		if (!isSwapPending)
+		{
+			if (reverb) isPreDelaySwapPending |= reverb->allocateBuffers();
+			if (fdnReverb) isPreDelaySwapPending |= fdnReverb->allocateBuffers();
+		}
+		return isSwapPending || isPreDelaySwapPending;
+	}
+
+	// Call with the audio thread locked, only exchanges pointers
+	void swapBuffers()
+	{
+		if (reverb) reverb->swapBuffers();
+		if (fdnReverb) fdnReverb->swapBuffers();
+
+		if (isSwapPending)
+		{
+			Reverb* previousReverb = reverb;
+			FdnReverb* previousFdnReverb = fdnReverb;
+			reverb = pendingReverb;
+			fdnReverb = pendingFdnReverb;
+			pendingReverb = previousReverb;
+			pendingFdnReverb = previousFdnReverb;
+			bufferSampleRate = pendingSampleRate;
+			isParameterChanged = true;
+			isSwapPending = false;
+		}
+	}
+
+	// Non audio thread, after swapBuffers
+	void freeBuffers()
+	{
+		if (reverb) reverb->freeBuffers();
+		if (fdnReverb) fdnReverb->freeBuffers();
+
+		if (!isSwapPending)
+		{
+			delete pendingReverb;
+			delete pendingFdnReverb;
+			pendingReverb = 0;
+			pendingFdnReverb = 0;
+		}
+	}
+
+	// sendL, sendR: reverb only input that does not go to the dry output
+	void process(float *sampleL, float *sampleR, const float *sendL, const float *sendR, int numSamples) 
+	{
+		if (isParameterChanged)
+		{
+			applyParameters();
+		}
+
+		if (wet <= 0.0f)
+		{
+			addIdleSamples(numSamples);
+			return;
+		}
+
+		if (!isCurrent())
+		{
+			addIdleSamples(numSamples);
+			for (int i = 0; i < numSamples; i++)
+			{
+				sampleL[i] *= dry;
+				sampleR[i] *= dry;
+			}
+			return;
+		}
+
+		while (numSamples > 0)
+		{
+			int blockSize = numSamples < MAX_BLOCK_SIZE ? numSamples : MAX_BLOCK_SIZE;
+			processBlock(sampleL, sampleR, sendL, sendR, blockSize);
+			sampleL += blockSize;
+			sampleR += blockSize;
+			sendL += blockSize;
+			sendR += blockSize;
+			numSamples -= blockSize;
+		}
+	}
+
+private:
+	// The reverb of the selected mode is there for the current sample rate
+	inline bool isCurrent()
+	{
+		return (isFdnEnabled ? fdnReverb != 0 : reverb != 0) && bufferSampleRate == sampleRate;
+	}
+
+	inline void addIdleSamples(int numSamples)
+	{
+		idleSamples += numSamples;
+		if (idleSamples > releaseSamples) idleSamples = releaseSamples;
+	}
+
+	void applyParameters()
+	{
+		isParameterChanged = false;
+		if (reverb)
+		{
+			reverb->setDecayTime(decayTime);
+			reverb->setPreDelay(preDelay);
+			reverb->setLowCut(lowCut);
+			reverb->setHighCut(highCut);
+			reverb->setStereoMode(stereoMode > 0.0f ? true : false);
+		}
+		if (fdnReverb)
+		{
+			fdnReverb->setDecayTime(decayTime);
+			fdnReverb->setPreDelay(preDelay);
+			fdnReverb->setLowCut(lowCut);
+			fdnReverb->setHighCut(highCut);
+		}
+	}
+
+	inline void processBlock(float *sampleL, float *sampleR, const float *sendL, const float *sendR, const int numSamples) 
+	{
+		// Only skipped if the whole block is silent
+		bool isSilent = true;
+		for (int i = 0; i < numSamples; i++)
+		{
+			isSilent &= tailDetector->isSilent(fabsf(sampleL[i]) + fabsf(sendL[i]), fabsf(sampleR[i]) + fabsf(sendR[i]));
+		}
+		if (isSilent)
+		{
+			addIdleSamples(numSamples);
+			for (int i = 0; i < numSamples; i++)
+			{
+				sampleL[i] *= dry;
+				sampleR[i] *= dry;
+			}
+			return;
+		}
+		idleSamples = 0;
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			float noise = noiseGenerator->tickNoise() * 0.000000001f;
 
-		    *sampleL += noise;
-		    *sampleR += noise;
+			drySampleL[i] = sampleL[i] + noise;
+			drySampleR[i] = sampleR[i] + noise;
 
-		    float drysampleL = *sampleL;
-		    float drysampleR = *sampleR;
+			reverbL[i] = drySampleL[i] + sendL[i];
+			reverbR[i] = drySampleR[i] + sendR[i];
+		}
 
-		    reverb->process(sampleL, sampleR);
+		if (isFdnEnabled)
+		{
+			fdnReverb->process(reverbL, reverbR, numSamples);
+		}
+		else
+		{
+			reverb->process(reverbL, reverbR, numSamples);
+		}
 
-		    // Process Stereo
-		    float wet1 = wet * (stereoWidth * 0.5f + 0.5f);
-		    float wet2 = wet * ((1.0f - stereoWidth) * 0.5f);
-		    float resultL = *sampleL * wet1 + *sampleR * wet2 + drysampleL * dry;
-		    float resultR = *sampleR * wet1 + *sampleL * wet2 + drysampleR * dry;
-		    *sampleL = resultL;
-		    *sampleR = resultR;
-        }
+		// Process Stereo
+		float wet1 = wet * (stereoWidth * 0.5f + 0.5f);
+		float wet2 = wet * ((1.0f - stereoWidth) * 0.5f);
+		for (int i = 0; i < numSamples; i++)
+		{
+			tailDetector->tick(reverbL[i], reverbR[i]);
+			sampleL[i] = reverbL[i] * wet1 + reverbR[i] * wet2 + drySampleL[i] * dry;
+			sampleR[i] = reverbR[i] * wet1 + reverbL[i] * wet2 + drySampleR[i] * dry;
+		}
 	}
 };
 #endif
@@ -24,15 +24,20 @@
 #if !defined(__ADSR_h)
 #define __ADSR_h
 
+#include "AdsrRateTable.h"
+
 class Adsr 
 {
+public:
+	// Longest block process() is called with
+	static const int MAX_BLOCK_SIZE = 64;
+
 private:
 	float attackReal;
 	float attack;
 	float decayReal;
 	float decay;
 	float sustainReal;
-	float sustain;
 	float release;
 
 	float sampleRateFactor;
@@ -48,11 +53,10 @@ class Adsr
 		state = 0;
 		actualValue = 0.0f;
 
-		sampleRateFactor = 0.004f * 44100.0f / sampleRate;
+		sampleRateFactor = getSampleRateFactor(sampleRate);
 
 		attack = 0.0f;
 		decay = 0.0f;
-		sustain = 1.0f;
 		release = 0.0f;
 
 		sustainReal = 1.0f;
@@ -60,47 +64,216 @@ class Adsr
 		attackReal = 0.0f;
 	}
 
+	// The rates of the parameter values [0..1]. The engine computes them once
+	// per parameter change and hands them to the envelopes of all voices.
+	static float getAttackRate(float value, float sampleRate)
+	{
+		float sampleRateFactor = getSampleRateFactor(sampleRate);
+		float curve = AdsrRateTable::getInstance().getValue(AdsrRateTable::ATTACK, value);
+		return 0.0003f * sampleRateFactor + sampleRateFactor * curve * 7.0f;
+	}
+
+	static float getDecayRate(float value, float sampleRate)
+	{
+		float sampleRateFactor = getSampleRateFactor(sampleRate);
+		float curve = AdsrRateTable::getInstance().getValue(AdsrRateTable::DECAY, value);
+		return 0.0003f * sampleRateFactor + sampleRateFactor * curve * 7.0f;
+	}
+
+	static float getReleaseRate(float value, float sampleRate)
+	{
+		float sampleRateFactor = getSampleRateFactor(sampleRate);
+		float curve = AdsrRateTable::getInstance().getValue(AdsrRateTable::RELEASE, value);
+		return (0.0003f * sampleRateFactor + sampleRateFactor * curve * 2.0f) * 8.0f;
+	}
+
 private:
-	float scaleValue(float value)
+	static float getSampleRateFactor(float sampleRate)
+	{
+		return 0.004f * 44100.0f / sampleRate;
+	}
+
+	// Number of steps of x += rate * x until x passes limit, at least one.
+	// rate != 0, x and limit > 0.
+	inline int getSegmentLength(float x, float limit, float rate, int maxLength)
+	{
+		if (rate <= -1.0f)
+		{
+			return 1;
+		}
+		float steps = logf(limit / x) / log1pf(rate);
+		if (!(steps < (float)maxLength))
+		{
+			return maxLength + 1;
+		}
+		int length = (int)steps + 1;
+		return length < 1 ? 1 : length;
+	}
+
+	// Samples that can run without a limit check. The closed form length
+	// can be a sample off, so the run stops short of it and the remaining
+	// samples are checked one by one.
+	inline int getUncheckedLength(float x, float limit, float rate, int numSamples)
+	{
+		int run = getSegmentLength(x, limit, rate, numSamples) - 2;
+		return run < 0 ? 0 : run;
+	}
+
+	// actualValue += attack * (actualValue + sampleRateFactor), output value^5
+	inline int processAttackExp(float *output, int numSamples)
 	{
-		value = 1.0f - value * 0.5f;
-		return 0.0003f * sampleRateFactor + sampleRateFactor * powf(value, 22.0f) * 2.0f;
+		int run = getUncheckedLength(actualValue + sampleRateFactor, 1.0f + sampleRateFactor, attack, numSamples);
+		float value = actualValue;
+		int i = 0;
+		for (; i < run; i++)
+		{
+			value += attack * (value + sampleRateFactor);
+			output[i] = value * value * value * value * value;
+		}
+		if (value > 1.0f)
+		{
+			// Overshot the estimate, redo the run with checks
+			value = actualValue;
+			i = 0;
+		}
+		for (; i < numSamples; i++)
+		{
+			value += attack * (value + sampleRateFactor);
+			if (value > 1.0f)
+			{
+				actualValue = 1.0f;
+				output[i++] = 1.0f;
+				state = 1;
+				return i;
+			}
+			output[i] = value * value * value * value * value;
+		}
+		actualValue = value;
+		return i;
+	}
+
+	// Approaches 1.04 + attackReal * 0.5 and stops at 1
+	inline int processAttackLinear(float *output, int numSamples)
+	{
+		float target = 1.04f + this->attackReal * 0.5f;
+		float rate = attack * sampleRateFactor * 200.0f;
+		int run = getUncheckedLength(target - actualValue, target - 1.0f, -rate, numSamples);
+		float value = actualValue;
+		int i = 0;
+		for (; i < run; i++)
+		{
+			value += rate * (target - value);
+			output[i] = value;
+		}
+		if (value > 1.0f)
+		{
+			value = actualValue;
+			i = 0;
+		}
+		for (; i < numSamples; i++)
+		{
+			value += rate * (target - value);
+			if (value > 1.0f)
+			{
+				actualValue = 1.0f;
+				output[i++] = 1.0f;
+				state = 1;
+				return i;
+			}
+			output[i] = value;
+		}
+		actualValue = value;
+		return i;
 	}
 
-	float scaleValueAttack(float value)
+	// actualValue -= decay * (actualValue + sampleRateFactor) down to the sustain
+	inline int processDecay(float *output, int numSamples)
 	{
-		value = 1.0f - value * 0.5f;
-		return 0.0003f * sampleRateFactor + sampleRateFactor * powf(value, 24.0f) * 7.0f;
+		int run = getUncheckedLength(actualValue + sampleRateFactor, sustainReal + sampleRateFactor, -decay, numSamples);
+		float value = actualValue;
+		int i = 0;
+		for (; i < run; i++)
+		{
+			value -= decay * (value + sampleRateFactor);
+			output[i] = value;
+		}
+		if (value <= sustainReal)
+		{
+			value = actualValue;
+			i = 0;
+		}
+		for (; i < numSamples; i++)
+		{
+			value -= decay * (value + sampleRateFactor);
+			if (value <= sustainReal)
+			{
+				actualValue = sustainReal;
+				output[i++] = sustainReal;
+				state = 2;
+				return i;
+			}
+			output[i] = value;
+		}
+		actualValue = value;
+		return i;
 	}
 
-	float scaleValueDecay(float value)
+	// actualValue -= release * (actualValue + sampleRateFactor) down to 0
+	inline int processRelease(float *output, int numSamples)
 	{
-		value = 1.0f - value * 0.5f;
-		return 0.0003f * sampleRateFactor + sampleRateFactor * powf(value, 23.0f) * 7.0f;
+		int run = getUncheckedLength(actualValue + sampleRateFactor, sampleRateFactor, -release, numSamples);
+		float value = actualValue;
+		int i = 0;
+		for (; i < run; i++)
+		{
+			value -= release * (value + sampleRateFactor);
+			output[i] = value;
+		}
+		if (value < 0.0f)
+		{
+			value = actualValue;
+			i = 0;
+		}
+		for (; i < numSamples; i++)
+		{
+			value -= release * (value + sampleRateFactor);
+			if (value < 0.0f)
+			{
+				actualValue = 0.0f;
+				output[i++] = 0.0f;
+				state = 4;
+				return i;
+			}
+			output[i] = value;
+		}
+		actualValue = value;
+		return i;
 	}
 
 public:
-	void setAttack(float value)
+	// rate: getAttackRate(value)
+	void setAttack(float value, float rate)
 	{
 		this->attackReal = value;
-		this->attack = this->scaleValueAttack(value);
+		this->attack = rate;
 	}
 
-	void setDecay(float value)
+	// rate: getDecayRate(value)
+	void setDecay(float value, float rate)
 	{
 		this->decayReal = value;
-		this->decay = this->scaleValueDecay(value);
+		this->decay = rate;
 	}
 
 	void setSustain(float value)
 	{
 		this->sustainReal = value;
-		this->sustain = this->scaleValue(value);
 	}
 
-	void setRelease(float value)
+	// rate: getReleaseRate(value)
+	void setRelease(float rate)
 	{
-		this->release = this->scaleValue(value) * 8.0f;
+		this->release = rate;
 	}
 
 	inline float tick(bool noteOn, bool isAttackExp) 
@@ -170,6 +343,58 @@ class Adsr
 		return returnValue;
 	}
 
+	// Renders numSamples envelope values, same output as calling tick() per
+	// sample. Each segment is an exponential approach, so the number of
+	// samples up to the next state change is estimated in closed form and
+	// the run in between is a plain recurrence without state checks. The
+	// samples around the estimate are checked like tick() does.
+	inline void process(bool noteOn, bool isAttackExp, float *output, int numSamples)
+	{
+		if (!noteOn)
+		{
+			state = actualValue > 0.0f ? 3 : 4;
+		}
+
+		int i = 0;
+		while (i < numSamples)
+		{
+			int remaining = numSamples - i;
+			switch (state)
+			{
+			case 0:
+				if (isAttackExp)
+				{
+					i += processAttackExp(output + i, remaining);
+				}
+				else
+				{
+					i += processAttackLinear(output + i, remaining);
+				}
+				break;
+			case 1:
+				i += processDecay(output + i, remaining);
+				break;
+			case 2:
+				actualValue = sustainReal;
+				for (; i < numSamples; i++)
+				{
+					output[i] = sustainReal;
+				}
+				break;
+			case 3:
+				i += processRelease(output + i, remaining);
+				break;
+			case 4:
+				actualValue = 0.0f;
+				for (; i < numSamples; i++)
+				{
+					output[i] = 0.0f;
+				}
+				break;
+			}
+		}
+	}
+
 	bool isNotePlaying(bool noteOn)
 	{
 		return noteOn || actualValue > 0;
@@ -44,6 +44,7 @@ class AdsrHandler
 private:
 	Adsr *adsr;
 	Destination destination;
+	float buffer[Adsr::MAX_BLOCK_SIZE];
 
 public:
 	float value;
@@ -64,14 +65,14 @@ class AdsrHandler
 		delete adsr;
 	}
 
-	void setAttack(float value)
+	void setAttack(float value, float rate)
 	{
-		this->adsr->setAttack(value);
+		this->adsr->setAttack(value, rate);
 	}
 
-	void setDecay(float value)
+	void setDecay(float value, float rate)
 	{
-		this->adsr->setDecay(value);
+		this->adsr->setDecay(value, rate);
 	}
 
 	void setSustain(float value)
@@ -79,9 +80,9 @@ class AdsrHandler
 		this->adsr->setSustain(value);
 	}
 
-	void setRelease(float value)
+	void setRelease(float rate)
 	{
-		this->adsr->setRelease(value);
+		this->adsr->setRelease(rate);
 	}
 
 	void resetState()
@@ -105,9 +106,10 @@ class AdsrHandler
 		this->amountPositive = fabs(amount);
 	}
 
-	void process(bool isNoteOn)
+	// Advances the envelope by one control block
+	void process(bool isNoteOn, int numSamples)
 	{
-		this->adsr->tick(isNoteOn, true);
+		this->adsr->process(isNoteOn, true, this->buffer, numSamples);
 		value = this->adsr->getValueFasterAttack();
 	}
 
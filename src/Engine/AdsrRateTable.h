@@ -0,0 +1,81 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__AdsrRateTable_h)
+#define __AdsrRateTable_h
+
+#include "Math.h"
+
+// The envelope rate curves (1 - value / 2)^exponent for the exponents the
+// Adsr uses, as linear interpolated tables. One instance is shared by all
+// envelopes, so a parameter change costs a table lookup instead of powf.
+class AdsrRateTable 
+{
+public:
+	enum Curve
+	{
+		RELEASE = 0, // exponent 22
+		DECAY,       // exponent 23
+		ATTACK,      // exponent 24
+		NUM_CURVES
+	};
+
+	static const int TABLE_SIZE = 1024;
+
+private:
+	float table[NUM_CURVES][TABLE_SIZE + 1];
+
+	AdsrRateTable() 
+	{
+		for (int curve = 0; curve < NUM_CURVES; curve++)
+		{
+			float exponent = 22.0f + curve;
+			for (int i = 0; i <= TABLE_SIZE; i++)
+			{
+				float value = (float)i / TABLE_SIZE;
+				table[curve][i] = powf(1.0f - value * 0.5f, exponent);
+			}
+		}
+	}
+
+public:
+	static const AdsrRateTable &getInstance()
+	{
+		static AdsrRateTable instance;
+		return instance;
+	}
+
+	// value [0..1]
+	inline float getValue(Curve curve, float value) const
+	{
+		if (value < 0.0f) value = 0.0f;
+		if (value > 1.0f) value = 1.0f;
+
+		float position = value * TABLE_SIZE;
+		int index = (int)position;
+		if (index >= TABLE_SIZE) index = TABLE_SIZE - 1;
+		float frac = position - index;
+		return table[curve][index] + (table[curve][index + 1] - table[curve][index]) * frac;
+	}
+};
+#endif
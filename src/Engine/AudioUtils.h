@@ -190,35 +190,36 @@ class AudioUtils
 		return answer;
 	}
 
-    char* getSyncedRateAndGetText(float *rate, float bpm)
+    // Sync rate selector [0..1] to lfo cycles per beat, 1/16 to 2/1 in
+    // straight, triplet and dotted variants
+    float getSyncedCyclesPerBeat(float rate)
     {
-        char *text;
-        int rateSelector = (int)(*rate * 17.0f + 0.001f);
+        static const float cyclesPerBeat[18] =
+        {
+            4.0f, 2.0f, 1.0f, 0.5f, 0.25f, 0.125f,
+            4.0f * 1.5f, 2.0f * 1.5f, 1.0f * 1.5f, 0.5f * 1.5f, 0.25f * 1.5f, 0.125f * 1.5f,
+            4.0f * 1.33333333f, 2.0f * 1.33333333f, 1.0f * 1.33333333f, 0.5f * 1.33333333f, 0.25f * 1.33333333f, 0.125f * 1.33333333f
+        };
+        return cyclesPerBeat[getSyncedRateSelector(rate)];
+    }
 
-        switch (rateSelector)
+    const char* getSyncedRateText(float rate)
+    {
+        static const char *text[18] =
         {
-        case 0: *rate = bpm/60.0f*4.0f; text = "1/16"; break;                   // 1/16
-        case 1: *rate = bpm/60.0f*2.0f; text = "1/8"; break;                	// 1/8
-        case 2: *rate = bpm/60.0f*1.00f; text = "1/4"; break;					// 1/4
-        case 3: *rate = bpm/60.0f*0.5f; text = "1/2"; break;                   // 1/2
-        case 4: *rate = bpm/60.0f*0.25f; text = "1/1"; break;					// 1/1
-        case 5: *rate = bpm/60.0f*0.125f; text = "2/1"; break;					// 2/1
-
-        case 6: *rate = bpm/60.0f*4.0f*1.5f; text = "1/16T"; break;				// 1/16T
-        case 7: *rate = bpm/60.0f*2.0f*1.5f; text = "1/8T"; break;				// 1/8T
-        case 8: *rate = bpm/60.0f*1.00f*1.5f; text = "1/4T"; break;				// 1/4T
-        case 9: *rate = bpm/60.0f*0.5f*1.5f; text = "1/2T"; break;				// 1/2T
-        case 10: *rate = bpm/60.0f*0.25f*1.5f; text = "1/1T"; break;			// 1/1T
-        case 11: *rate = bpm/60.0f*0.125f*1.5f; text = "2/1T"; break;			// 2/1T
-
-        case 12: *rate = bpm/60.0f*4.0f*1.33333333f; text = "1/16."; break;		// 1/16.
-        case 13: *rate = bpm/60.0f*2.0f*1.33333333f; text = "1/8."; break;		// 1/8.
-        case 14: *rate = bpm/60.0f*1.00f*1.33333333f; text = "1/4."; break;		// 1/4.
-        case 15: *rate = bpm/60.0f*0.5f*1.33333333f; text = "1/2."; break;		// 1/2.
-        case 16: *rate = bpm/60.0f*0.25f*1.33333333f; text = "1/1."; break;		// 1/1.
-        case 17: *rate = bpm/60.0f*0.125f*1.33333333f; text = "2/1."; break;	// 2/1.
-        }
-        return text;
+            "1/16", "1/8", "1/4", "1/2", "1/1", "2/1",
+            "1/16T", "1/8T", "1/4T", "1/2T", "1/1T", "2/1T",
+            "1/16.", "1/8.", "1/4.", "1/2.", "1/1.", "2/1."
+        };
+        return text[getSyncedRateSelector(rate)];
+    }
+
+    int getSyncedRateSelector(float rate)
+    {
+        int rateSelector = (int)(rate * 17.0f + 0.001f);
+        if (rateSelector < 0) rateSelector = 0;
+        if (rateSelector > 17) rateSelector = 17;
+        return rateSelector;
     }
 
     float getTranspose(float value)
@@ -1,47 +1,3 @@
-class Upsample
-{
-private:
-	float b0, b1, b2, b3;
-
-	float returnValues[4];
-
-public:
-	Upsample::Upsample()
-	{
-		b0= b1= b2= b3= 0.0f;
-	}
-
-	// TODO: http://www.dspguru.com/dsp/faqs/multirate/interpolation
-
-	float* Calc(const float sample)
-	{
-		// Queue with real values
-		b3 = b2;
-		b2 = b1;
-		b1 = b0;
-		b0 = sample;
-
-		// Get interpolated values between b1 and b2
-		returnValues[0] = b1; 
-		returnValues[1] = hermite2(0.25f, b0, b1, b2, b3);
-		returnValues[2] = hermite2(0.50f, b0, b1, b2, b3);
-		returnValues[3] = hermite2(0.75f, b0, b1, b2, b3);
-
-		return returnValues;
-	}
-
-	inline float hermite2(const float x, const float y0, const float y1, const float y2, const float y3)
-	{
-		// 4-point, 3rd-order Hermite (x-form)
-		float c0 = y1;
-		float c1 = 0.5f * (y2 - y0);
-		float c3 = 1.5f * (y1 - y2) + 0.5f * (y3 - y0);
-		float c2 = y0 - y1 + c1 - c3;
-
-		return ((c3 * x + c2) * x + c1) * x + c0;
-	}
-};
-
 //Filtres dcimateurs
 // T.Rochebois
 // Based on
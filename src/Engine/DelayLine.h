@@ -0,0 +1,164 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__DelayLine_h)
+#define __DelayLine_h
+
+// Ring buffer with a guard zone behind its end that mirrors the first
+// samples of the line. Up to getGuardLength() + 1 samples can be read
+// forward from any position without wrapping, and a block of up to
+// getGuardLength() samples can be written contiguously through
+// getWritePointer() followed by advance(). The length can be anything,
+// it does not have to be a power of two, and can be shortened later
+// without reallocating.
+class DelayLine
+{
+private:
+	float *buffer;
+	int capacity;
+	int maxGuardLength;
+	int length;
+	int guardLength;
+	int writePos;
+
+public:
+	DelayLine(int length, int guardLength)
+	{
+		capacity = length;
+		maxGuardLength = guardLength;
+		buffer = new float[capacity + guardLength];
+		setLength(length);
+	}
+
+	~DelayLine()
+	{
+		delete[] buffer;
+	}
+
+	// Starts from silence, false if the line is too short for the length
+	bool setLength(int length)
+	{
+		if (length > capacity)
+		{
+			return false;
+		}
+		this->length = length;
+
+		// The guard can only mirror what is there
+		guardLength = maxGuardLength < length ? maxGuardLength : length;
+		clear();
+		return true;
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < length + guardLength; i++)
+			buffer[i] = 0.0f;
+		writePos = 0;
+	}
+
+	// Starts with the most recent samples of another line, as many as fit
+	void copyHistory(const DelayLine *source)
+	{
+		clear();
+		int numSamples = source->length < length ? source->length : length;
+		for (int delay = numSamples; delay > 0; delay--)
+			write(source->read(delay));
+	}
+
+	inline int getLength() const
+	{
+		return length;
+	}
+
+	inline int getCapacity() const
+	{
+		return capacity;
+	}
+
+	// Longest block that can be written or read without wrapping
+	inline int getGuardLength() const
+	{
+		return guardLength;
+	}
+
+	// Position of the sample written delay samples ago, delay [0..length].
+	// A delay of length is the oldest sample, the one overwritten next.
+	inline int getReadPosition(int delay) const
+	{
+		int position = writePos - delay;
+		if (position < 0) position += length;
+		return position;
+	}
+
+	// Valid from getReadPosition up to getGuardLength() samples past it
+	inline const float *getData() const
+	{
+		return buffer;
+	}
+
+	inline float read(int delay) const
+	{
+		return buffer[getReadPosition(delay)];
+	}
+
+	inline void write(float sample)
+	{
+		buffer[writePos] = sample;
+		if (writePos < guardLength) buffer[writePos + length] = sample;
+		if (++writePos >= length) writePos = 0;
+	}
+
+	// Write the next getGuardLength() samples at most here, before the
+	// write the pointer still holds the oldest samples
+	inline float *getWritePointer()
+	{
+		return buffer + writePos;
+	}
+
+	// Call after writing numSamples through getWritePointer
+	inline void advance(int numSamples)
+	{
+		int end = writePos + numSamples;
+
+		// Written past the end into the guard, copy to the start of the line
+		for (int i = length; i < end; i++)
+			buffer[i - length] = buffer[i];
+
+		// Written to the start of the line, copy to the guard
+		int mirrorEnd = end < guardLength ? end : guardLength;
+		for (int i = writePos; i < mirrorEnd; i++)
+			buffer[i + length] = buffer[i];
+
+		writePos = end >= length ? end - length : end;
+	}
+
+	inline void write(const float *samples, int numSamples)
+	{
+		float *data = getWritePointer();
+		for (int i = 0; i < numSamples; i++)
+			data[i] = samples[i];
+		advance(numSamples);
+	}
+};
+#endif
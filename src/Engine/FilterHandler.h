@@ -25,145 +25,241 @@
 #define __FilterHandler_h_
 
 #include "Decimator.h"
-#include "InterpolatorLinear.h"
-#include "FilterLp24db.h"
-#include "FilterLp18db.h"
-#include "FilterLp12db.h"
-#include "FilterLp06db.h"
-#include "FilterHp24db.h"
-#include "FilterBp24db.h"
-#include "FilterN24db.h"
+#include "HalfBandInterpolator.h"
+#include "FilterSlot.h"
 
 class FilterHandler
 {
+public:
+	enum Routing
+	{
+		SERIAL = 0,
+		PARALLEL,
+		STEREO,
+	};
+
 private:
+	// interpolator and decimator resample between 1x and 2x, interpolator2
+	// and decimator2 between 2x and 4x. The R decimators are the right side
+	// of the stereo routing.
+	HalfBandInterpolator *interpolator;
+	HalfBandInterpolator *interpolator2;
 	Decimator9 *decimator;
 	Decimator9 *decimator2;
-	Upsample *upsample;
-	InterpolatorLinear *interpolatorLinear;
+	Decimator9 *decimatorR;
+	Decimator9 *decimator2R;
 
-	FilterLp24db *filterLp24db;
-	FilterLp18db *filterLp18db;
-	FilterLp12db *filterLp12db;
-	FilterLp06db *filterLp06db;
+	FilterSlot *filter1;
+	FilterSlot *filter2;
 
-	FilterHp24db *filterHp24db;
-	FilterBp24db *filterBp24db;
-	FilterN24db *filterN24db;
+	Routing routing;
+	int oversampling;
 
-	int filtertype;
-    float *upsampledValues;
-    
+	float upsampledValues[4];
+	float upsampledValues2[4];
+	float halfValues[2];
 
 public:
 	FilterHandler(float sampleRate) 
 	{
-		upsample = new Upsample();
+		interpolator = new HalfBandInterpolator();
+		interpolator2 = new HalfBandInterpolator();
 		decimator = new Decimator9();
 		decimator2 = new Decimator9();
-		interpolatorLinear = new InterpolatorLinear();
-        upsampledValues = new float[4];
+		decimatorR = new Decimator9();
+		decimator2R = new Decimator9();
 
-		filterLp24db = new FilterLp24db(sampleRate * 4.0f);
-		filterLp18db = new FilterLp18db(sampleRate * 4.0f);
-		filterLp12db = new FilterLp12db(sampleRate * 4.0f);
-		filterLp06db = new FilterLp06db(sampleRate * 4.0f);
-		filterHp24db = new FilterHp24db(sampleRate * 4.0f);
-		filterBp24db = new FilterBp24db(sampleRate * 4.0f);
-		filterN24db = new FilterN24db(sampleRate * 4.0f);
+		filter1 = new FilterSlot(sampleRate);
+		filter2 = new FilterSlot(sampleRate);
 
-        filtertype = 0;
-    }
+		routing = SERIAL;
+		oversampling = 4;
+	}
 
 	~FilterHandler()
 	{
+		delete interpolator;
+		delete interpolator2;
 		delete decimator;
 		delete decimator2;
-		delete upsample;
-		delete interpolatorLinear;
-		delete filterLp24db;
-		delete filterLp18db;
-		delete filterLp12db;
-		delete filterLp06db;
-		delete filterHp24db;
-		delete filterBp24db;
-		delete filterN24db;
-		delete upsampledValues;
+		delete decimatorR;
+		delete decimator2R;
+		delete filter1;
+		delete filter2;
 	}
 
 	void setFiltertype(float value)
 	{
-        this->filtertype = (int)value;
+		bool wasRightUsed = isRightUsed();
+		filter1->setFiltertype((int)value);
+		updateOversampling(wasRightUsed);
+	}
+
+	void setFilter2type(float value)
+	{
+		bool wasRightUsed = isRightUsed();
+		filter2->setFiltertype((int)value);
+		updateOversampling(wasRightUsed);
+	}
+
+	void setRouting(Routing routing)
+	{
+		bool wasRightUsed = isRightUsed();
+		this->routing = routing;
+		resetStartedStages(oversampling, wasRightUsed);
+	}
+
+	void reset()
+	{
+		interpolator->reset();
+		interpolator2->reset();
+		decimator->Initialize();
+		decimator2->Initialize();
+		decimatorR->Initialize();
+		decimator2R->Initialize();
+		filter1->reset();
+		filter2->reset();
 	}
 
-    void reset()
-    {
-        decimator->Initialize();
-        decimator2->Initialize();
-        filterLp24db->reset();
-		filterLp18db->reset();
-		filterLp12db->reset();
-		filterLp06db->reset();
-		filterHp24db->reset();
-		filterBp24db->reset();
-		filterN24db->reset();
-    }
-
-	inline void process(float *input, float cutoff, float resonance) 
+	// Filters the mono voice sample in sampleL. Both outputs get the same
+	// signal except for stereo routing, filter 1 left and filter 2 right.
+	inline void process(float *sampleL, float *sampleR, float cutoff, float resonance, float cutoff2, float resonance2) 
 	{
-		interpolatorLinear->process4x(*input, upsampledValues);
+		upsample(*sampleL, upsampledValues);
 
-		// Do oversampled stuff here
-		switch (filtertype)
+		if (!filter2->isEnabled())
 		{
-		case 1: 
-			filterLp24db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterLp24db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterLp24db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterLp24db->process(&upsampledValues[3], cutoff, resonance, false);
-			break;
-		case 2: 
-			filterLp18db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterLp18db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterLp18db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterLp18db->process(&upsampledValues[3], cutoff, resonance, false);
+			filter1->process(upsampledValues, oversampling, cutoff, resonance);
+			downsample(upsampledValues, sampleL, decimator, decimator2);
+			*sampleR = *sampleL;
+			return;
+		}
+
+		switch (routing)
+		{
+		case SERIAL:
+			filter1->process(upsampledValues, oversampling, cutoff, resonance);
+			filter2->process(upsampledValues, oversampling, cutoff2, resonance2);
+			downsample(upsampledValues, sampleL, decimator, decimator2);
+			*sampleR = *sampleL;
 			break;
-		case 3: 
-			filterLp12db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterLp12db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterLp12db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterLp12db->process(&upsampledValues[3], cutoff, resonance, false);
+		case PARALLEL:
+			memcpy(upsampledValues2, upsampledValues, oversampling * sizeof(float));
+			filter1->process(upsampledValues, oversampling, cutoff, resonance);
+			filter2->process(upsampledValues2, oversampling, cutoff2, resonance2);
+
+			// Linear from here, so one decimation pass for both filters
+			for (int i = 0; i < oversampling; i++)
+			{
+				upsampledValues[i] = (upsampledValues[i] + upsampledValues2[i]) * 0.5f;
+			}
+			downsample(upsampledValues, sampleL, decimator, decimator2);
+			*sampleR = *sampleL;
 			break;
-		case 4: 
-			filterLp06db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterLp06db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterLp06db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterLp06db->process(&upsampledValues[3], cutoff, resonance, false);
+		case STEREO:
+			memcpy(upsampledValues2, upsampledValues, oversampling * sizeof(float));
+			filter1->process(upsampledValues, oversampling, cutoff, resonance);
+			filter2->process(upsampledValues2, oversampling, cutoff2, resonance2);
+			downsample(upsampledValues, sampleL, decimator, decimator2);
+			downsample(upsampledValues2, sampleR, decimatorR, decimator2R);
 			break;
-		case 5: 
-			filterHp24db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterHp24db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterHp24db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterHp24db->process(&upsampledValues[3], cutoff, resonance, false);
+		}
+	}
+
+private:
+	bool isRightUsed()
+	{
+		return routing == STEREO && filter2->isEnabled();
+	}
+
+	// Both slots run at the highest rate one of them needs. The filters keep
+	// their state across the change, so switching the type during a note
+	// does not click.
+	void updateOversampling(bool wasRightUsed)
+	{
+		int oversampling = filter1->getOversampling();
+		if (filter2->getOversampling() > oversampling) oversampling = filter2->getOversampling();
+		if (oversampling < 1) oversampling = 1;
+
+		filter1->setOversampling(oversampling);
+		filter2->setOversampling(oversampling);
+
+		int oldOversampling = this->oversampling;
+		this->oversampling = oversampling;
+		resetStartedStages(oldOversampling, wasRightUsed);
+	}
+
+	// Resampler stages that were not running hold a stale history, they are
+	// cleared when they start again. The running ones are left alone.
+	void resetStartedStages(int oldOversampling, bool wasRightUsed)
+	{
+		bool isRight = isRightUsed();
+
+		if (oversampling >= 2)
+		{
+			bool wasRunning = oldOversampling >= 2;
+			if (!wasRunning)
+			{
+				interpolator->reset();
+				decimator->Initialize();
+			}
+			if (isRight && !(wasRunning && wasRightUsed))
+			{
+				decimatorR->Initialize();
+			}
+		}
+
+		if (oversampling == 4)
+		{
+			bool wasRunning = oldOversampling == 4;
+			if (!wasRunning)
+			{
+				interpolator2->reset();
+				decimator2->Initialize();
+			}
+			if (isRight && !(wasRunning && wasRightUsed))
+			{
+				decimator2R->Initialize();
+			}
+		}
+	}
+
+	inline void upsample(float input, float *output)
+	{
+		switch (oversampling)
+		{
+		case 1:
+			output[0] = input;
 			break;
-		case 6: 
-            filterBp24db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterBp24db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterBp24db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterBp24db->process(&upsampledValues[3], cutoff, resonance, false);
+		case 2:
+			interpolator->tick(input, output);
 			break;
-		case 7: 
-            filterN24db->process(&upsampledValues[0], cutoff, resonance, true);
-			filterN24db->process(&upsampledValues[1], cutoff, resonance, false);
-			filterN24db->process(&upsampledValues[2], cutoff, resonance, false);
-			filterN24db->process(&upsampledValues[3], cutoff, resonance, false);
+		case 4:
+			interpolator->tick(input, halfValues);
+			interpolator2->tick(halfValues[0], output);
+			interpolator2->tick(halfValues[1], output + 2);
 			break;
 		}
+	}
 
-		float decimated1 = decimator->Calc(upsampledValues[0], upsampledValues[1]);
-		float decimated2 = decimator->Calc(upsampledValues[2], upsampledValues[3]);
-		*input = decimator2->Calc(decimated1, decimated2);
+	inline void downsample(float *input, float *output, Decimator9 *decimator, Decimator9 *decimator2)
+	{
+		switch (oversampling)
+		{
+		case 1:
+			*output = input[0];
+			break;
+		case 2:
+			*output = decimator->Calc(input[0], input[1]);
+			break;
+		case 4:
+		{
+			float decimated1 = decimator2->Calc(input[0], input[1]);
+			float decimated2 = decimator2->Calc(input[2], input[3]);
+			*output = decimator->Calc(decimated1, decimated2);
+			break;
+		}
+		}
 	}
 };
 #endif
-
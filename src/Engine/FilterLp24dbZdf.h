@@ -0,0 +1,135 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#ifndef __FilterLp24dbZdf_h_
+#define __FilterLp24dbZdf_h_
+
+#include "Math.h"
+
+// Zero delay feedback (topology preserving transform) ladder filter.
+// The feedback loop is solved instantaneously, so the filter keeps its tuning
+// and stays stable up to nyquist without the 4x oversampling the Huovilainen
+// ladders need. Based on "The Art of VA Filter Design" by Vadim Zavalishin.
+class FilterLp24dbZdf 
+{
+private:
+	float pi;
+	float s1, s2, s3, s4;
+	float G, k;
+
+	float sampleRate;
+	float maxFrequency;
+	float cutoffInOld;
+	float resonanceInOld;
+	float resonanceCorrPre;
+
+public:
+	FilterLp24dbZdf(float sampleRate) 
+	{
+		pi = 3.1415926535f;
+		G = k = 0.0f;
+		resonanceCorrPre = 1.0f;
+		setSampleRate(sampleRate);
+		reset();
+	}
+
+	// sampleRate is the rate the filter runs at, including oversampling
+	void setSampleRate(float sampleRate)
+	{
+		this->sampleRate = sampleRate;
+		this->maxFrequency = sampleRate * 0.45f;
+		cutoffInOld = -1.0f;
+		resonanceInOld = -1.0f;
+	}
+
+	void reset()
+	{
+		s1 = s2 = s3 = s4 = 0.0f;
+	}
+
+	inline void process(float *input, const float cutoffIn, const float resonance, const bool calcCeff) 
+	{
+		if (resonanceInOld != resonance)
+		{
+			resonanceInOld = resonance;
+			k = 4.2f * resonance;
+
+			// Gives back some of the bass the ladder looses with resonance
+			resonanceCorrPre = 1.0f + k * 0.5f;
+		}
+
+		// Cutoff from 0 (0Hz) to 1 (22050Hz), same range as the other filters
+		if (calcCeff && cutoffIn != cutoffInOld)
+		{
+			cutoffInOld = cutoffIn;
+			float frequency = 10.0f + cutoffIn * 22040.0f;
+			if (frequency > maxFrequency) frequency = maxFrequency;
+
+			float g = tanApp(pi * frequency / sampleRate);
+			G = g / (1.0f + g);
+		}
+
+		// Instantaneous response of the four one pole stages to their states
+		float G2 = G * G;
+		float S = (G2 * G * s1 + G2 * s2 + G * s3 + s4) * (1.0f - G);
+
+		// Solve the feedback loop, saturate the ladder input
+		float u = (*input * resonanceCorrPre - k * S) / (1.0f + k * G2 * G2);
+		u = tanhClipper(u);
+
+		float v = (u - s1) * G;
+		float y1 = v + s1;
+		s1 = y1 + v;
+
+		v = (y1 - s2) * G;
+		float y2 = v + s2;
+		s2 = y2 + v;
+
+		v = (y2 - s3) * G;
+		float y3 = v + s3;
+		s3 = y3 + v;
+
+		v = (y3 - s4) * G;
+		float y4 = v + s4;
+		s4 = y4 + v;
+
+		*input = y4;
+	}
+
+	// Pade approximation, accurate to 0.1% in the range [0..0.45pi]
+	inline float tanApp(const float x)
+	{
+		float x2 = x * x;
+		float x4 = x2 * x2;
+		return x * (945.0f - 105.0f * x2 + x4) / (945.0f - 420.0f * x2 + 15.0f * x4);
+	}
+
+	inline float tanhClipper(float x) 
+	{
+		x *= 2.0f;
+		float a = fabs(x);
+		float b = 6.0f + a * (3.0f + a);
+		return (x * b) / (a * b + 12.0f);
+	}
+};
+#endif
@@ -0,0 +1,192 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#ifndef __FilterSlot_h_
+#define __FilterSlot_h_
+
+#include "FilterLp24db.h"
+#include "FilterLp18db.h"
+#include "FilterLp12db.h"
+#include "FilterLp06db.h"
+#include "FilterHp24db.h"
+#include "FilterBp24db.h"
+#include "FilterN24db.h"
+#include "FilterLp24dbZdf.h"
+#include "FilterSvf12db.h"
+
+// One selectable filter of the FilterHandler. It only runs the filter
+// recurrence, the resampling around it is shared by all slots.
+class FilterSlot
+{
+private:
+	FilterLp24db *filterLp24db;
+	FilterLp18db *filterLp18db;
+	FilterLp12db *filterLp12db;
+	FilterLp06db *filterLp06db;
+
+	FilterHp24db *filterHp24db;
+	FilterBp24db *filterBp24db;
+	FilterN24db *filterN24db;
+
+	FilterLp24dbZdf *filterLp24dbZdf;
+	FilterSvf12db *filterSvf12db;
+
+	float sampleRate;
+	int filtertype;
+	int zdfOversampling;
+	int oversampling;
+
+public:
+	FilterSlot(float sampleRate) 
+	{
+		this->sampleRate = sampleRate;
+
+		filterLp24db = new FilterLp24db(sampleRate * 4.0f);
+		filterLp18db = new FilterLp18db(sampleRate * 4.0f);
+		filterLp12db = new FilterLp12db(sampleRate * 4.0f);
+		filterLp06db = new FilterLp06db(sampleRate * 4.0f);
+		filterHp24db = new FilterHp24db(sampleRate * 4.0f);
+		filterBp24db = new FilterBp24db(sampleRate * 4.0f);
+		filterN24db = new FilterN24db(sampleRate * 4.0f);
+
+		// The zdf filters stay in tune without oversampling, 2x is only
+		// used to keep the saturation aliasing down at low sample rates
+		zdfOversampling = sampleRate < 88200.0f ? 2 : 1;
+		oversampling = zdfOversampling;
+		filterLp24dbZdf = new FilterLp24dbZdf(sampleRate * zdfOversampling);
+		filterSvf12db = new FilterSvf12db(sampleRate * zdfOversampling);
+
+		filtertype = 0;
+	}
+
+	~FilterSlot()
+	{
+		delete filterLp24db;
+		delete filterLp18db;
+		delete filterLp12db;
+		delete filterLp06db;
+		delete filterHp24db;
+		delete filterBp24db;
+		delete filterN24db;
+		delete filterLp24dbZdf;
+		delete filterSvf12db;
+	}
+
+	void setFiltertype(int filtertype)
+	{
+		this->filtertype = filtertype;
+
+		switch (filtertype)
+		{
+		case 9: filterSvf12db->setMode(FilterSvf12db::LOWPASS); break;
+		case 10: filterSvf12db->setMode(FilterSvf12db::HIGHPASS); break;
+		case 11: filterSvf12db->setMode(FilterSvf12db::BANDPASS); break;
+		case 12: filterSvf12db->setMode(FilterSvf12db::NOTCH); break;
+		}
+	}
+
+	bool isEnabled()
+	{
+		return filtertype > 0;
+	}
+
+	// Oversampling the filter type needs, 0 if the slot is off
+	int getOversampling()
+	{
+		if (filtertype <= 0) return 0;
+		if (filtertype <= 7) return 4;
+		return zdfOversampling;
+	}
+
+	// The zdf filters can run at any rate, the others are tuned for 4x
+	void setOversampling(int oversampling)
+	{
+		if (this->oversampling != oversampling)
+		{
+			this->oversampling = oversampling;
+			filterLp24dbZdf->setSampleRate(sampleRate * oversampling);
+			filterSvf12db->setSampleRate(sampleRate * oversampling);
+		}
+	}
+
+	void reset()
+	{
+		filterLp24db->reset();
+		filterLp18db->reset();
+		filterLp12db->reset();
+		filterLp06db->reset();
+		filterHp24db->reset();
+		filterBp24db->reset();
+		filterN24db->reset();
+		filterLp24dbZdf->reset();
+		filterSvf12db->reset();
+	}
+
+	// Processes the oversampled values of one input sample
+	inline void process(float *samples, int numSamples, float cutoff, float resonance) 
+	{
+		switch (filtertype)
+		{
+		case 1: 
+			filterLp24db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterLp24db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 2: 
+			filterLp18db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterLp18db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 3: 
+			filterLp12db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterLp12db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 4: 
+			filterLp06db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterLp06db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 5: 
+			filterHp24db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterHp24db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 6: 
+			filterBp24db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterBp24db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 7: 
+			filterN24db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterN24db->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 8: 
+			filterLp24dbZdf->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterLp24dbZdf->process(&samples[i], cutoff, resonance, false);
+			break;
+		case 9: 
+		case 10: 
+		case 11: 
+		case 12: 
+			filterSvf12db->process(&samples[0], cutoff, resonance, true);
+			for (int i = 1; i < numSamples; i++) filterSvf12db->process(&samples[i], cutoff, resonance, false);
+			break;
+		}
+	}
+};
+#endif
@@ -0,0 +1,138 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#ifndef __FilterSvf12db_h_
+#define __FilterSvf12db_h_
+
+#include "Math.h"
+
+// Zero delay feedback (trapezoidal integrated) state variable filter.
+// Unconditionally stable and in tune up to nyquist, so it does not need
+// the oversampling of the ladder filters.
+class FilterSvf12db 
+{
+public:
+	enum Mode
+	{
+		LOWPASS,
+		HIGHPASS,
+		BANDPASS,
+		NOTCH,
+	};
+
+private:
+	float pi;
+	float ic1eq, ic2eq;
+	float k, a1, a2, a3;
+
+	Mode mode;
+
+	float sampleRate;
+	float maxFrequency;
+	float cutoffInOld;
+	float resonanceInOld;
+
+public:
+	FilterSvf12db(float sampleRate) 
+	{
+		pi = 3.1415926535f;
+		mode = LOWPASS;
+		k = 2.0f;
+		a1 = 1.0f;
+		a2 = a3 = 0.0f;
+		setSampleRate(sampleRate);
+		reset();
+	}
+
+	// sampleRate is the rate the filter runs at, including oversampling
+	void setSampleRate(float sampleRate)
+	{
+		this->sampleRate = sampleRate;
+		this->maxFrequency = sampleRate * 0.45f;
+		cutoffInOld = -1.0f;
+		resonanceInOld = -1.0f;
+	}
+
+	void setMode(const Mode mode)
+	{
+		this->mode = mode;
+	}
+
+	void reset()
+	{
+		ic1eq = ic2eq = 0.0f;
+	}
+
+	inline void process(float *input, const float cutoffIn, const float resonance, const bool calcCeff) 
+	{
+		bool updateCoefficients = false;
+		if (resonanceInOld != resonance)
+		{
+			resonanceInOld = resonance;
+			k = 2.0f - 1.98f * resonance;
+			updateCoefficients = true;
+		}
+
+		// Cutoff from 0 (0Hz) to 1 (22050Hz), same range as the other filters
+		if (calcCeff && cutoffIn != cutoffInOld)
+		{
+			cutoffInOld = cutoffIn;
+			updateCoefficients = true;
+		}
+
+		if (updateCoefficients && cutoffInOld >= 0.0f)
+		{
+			float frequency = 10.0f + cutoffInOld * 22040.0f;
+			if (frequency > maxFrequency) frequency = maxFrequency;
+
+			float g = tanApp(pi * frequency / sampleRate);
+			a1 = 1.0f / (1.0f + g * (g + k));
+			a2 = g * a1;
+			a3 = g * a2;
+		}
+
+		float v0 = *input;
+		float v3 = v0 - ic2eq;
+		float v1 = a1 * ic1eq + a2 * v3;
+		float v2 = ic2eq + a2 * ic1eq + a3 * v3;
+		ic1eq = 2.0f * v1 - ic1eq;
+		ic2eq = 2.0f * v2 - ic2eq;
+
+		switch (mode)
+		{
+		case LOWPASS: *input = v2; break;
+		case HIGHPASS: *input = v0 - k * v1 - v2; break;
+		case BANDPASS: *input = k * v1; break;
+		case NOTCH: *input = v0 - k * v1; break;
+		}
+	}
+
+	// Pade approximation, accurate to 0.1% in the range [0..0.45pi]
+	inline float tanApp(const float x)
+	{
+		float x2 = x * x;
+		float x4 = x2 * x2;
+		return x * (945.0f - 105.0f * x2 + x4) / (945.0f - 420.0f * x2 + 15.0f * x4);
+	}
+};
+#endif
@@ -0,0 +1,157 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#ifndef __HalfBandInterpolator_h_
+#define __HalfBandInterpolator_h_
+
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define HALFBAND_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Polyphase half band interpolator by 2, the counterpart of Decimator9 with
+// the same taps. Every input sample gives one filtered value from the
+// symmetric taps and one plain delayed value from the center tap, so there
+// is no linear interpolation imaging left in front of the nonlinear filters.
+class HalfBandInterpolator
+{
+public:
+	static const int TAPS = 10;
+	static const int MAX_BLOCK_SIZE = 64;
+
+private:
+	// Filter history followed by the input of the current block
+	float history[TAPS - 1 + MAX_BLOCK_SIZE];
+
+	// Taps with the interpolation gain of 2 applied
+	float coefficients[TAPS];
+
+	// Rolling history of tick(). Every sample is written twice, so the last
+	// TAPS samples are always contiguous from tickPosition + 1 on.
+	float ticks[2 * TAPS];
+	int tickPosition;
+
+public:
+	HalfBandInterpolator()
+	{
+		float h0;
+		getTaps(coefficients, &h0);
+		for (int i = 0; i < TAPS; i++)
+		{
+			coefficients[i] *= 2.0f;
+		}
+		reset();
+	}
+
+	// Same taps as Decimator9 (T.Rochebois)
+	// taps: the TAPS symmetric odd taps, h0: center tap
+	static void getTaps(float *taps, float *h0)
+	{
+		const float h1 = 5042 / 16384.0f;
+		const float h3 = -1277 / 16384.0f;
+		const float h5 = 429 / 16384.0f;
+		const float h7 = -116 / 16384.0f;
+		const float h9 = 18 / 16384.0f;
+
+		taps[0] = taps[9] = h9;
+		taps[1] = taps[8] = h7;
+		taps[2] = taps[7] = h5;
+		taps[3] = taps[6] = h3;
+		taps[4] = taps[5] = h1;
+		*h0 = 8192 / 16384.0f;
+	}
+
+	void reset()
+	{
+		memset(history, 0, sizeof(history));
+		memset(ticks, 0, sizeof(ticks));
+		tickPosition = 0;
+	}
+
+	// Two output values from one input sample, same result as process()
+	// without the block buffering
+	inline void tick(const float input, float *output)
+	{
+		ticks[tickPosition] = ticks[tickPosition + TAPS] = input;
+
+		const float *x = ticks + tickPosition + 1;
+		output[0] = coefficients[0] * (x[0] + x[9])
+			+ coefficients[1] * (x[1] + x[8])
+			+ coefficients[2] * (x[2] + x[7])
+			+ coefficients[3] * (x[3] + x[6])
+			+ coefficients[4] * (x[4] + x[5]);
+		output[1] = x[TAPS / 2];
+
+		if (++tickPosition == TAPS) tickPosition = 0;
+	}
+
+	// input: numSamples values, output: 2 * numSamples values
+	inline void process(const float *input, float *output, int numSamples)
+	{
+		while (numSamples > 0)
+		{
+			int blockSize = numSamples < MAX_BLOCK_SIZE ? numSamples : MAX_BLOCK_SIZE;
+			processBlock(input, output, blockSize);
+			input += blockSize;
+			output += 2 * blockSize;
+			numSamples -= blockSize;
+		}
+	}
+
+private:
+	inline void processBlock(const float *input, float *output, const int numSamples)
+	{
+		memcpy(history + TAPS - 1, input, numSamples * sizeof(float));
+
+		int i = 0;
+#if defined(HALFBAND_USE_SSE)
+		for (; i + 4 <= numSamples; i += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (int j = 0; j < TAPS; j++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(history + i + j), _mm_set1_ps(coefficients[j])));
+			}
+			__m128 delayed = _mm_loadu_ps(history + i + TAPS / 2);
+			_mm_storeu_ps(output + 2 * i, _mm_unpacklo_ps(sum, delayed));
+			_mm_storeu_ps(output + 2 * i + 4, _mm_unpackhi_ps(sum, delayed));
+		}
+#endif
+		for (; i < numSamples; i++)
+		{
+			const float *x = history + i;
+			output[2 * i] = coefficients[0] * (x[0] + x[9])
+				+ coefficients[1] * (x[1] + x[8])
+				+ coefficients[2] * (x[2] + x[7])
+				+ coefficients[3] * (x[3] + x[6])
+				+ coefficients[4] * (x[4] + x[5]);
+			output[2 * i + 1] = x[TAPS / 2];
+		}
+
+		// Keep the history for the next block
+		memmove(history, history + numSamples, (TAPS - 1) * sizeof(float));
+	}
+};
+#endif
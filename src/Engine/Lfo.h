@@ -2,15 +2,15 @@
 #define LFO_H
 
 #include <string>
-#include "OscNoise.h"
+#include "LfoWaveform.h"
 
 //==============================================================================
 /**
-   This class implements a LUT-based LFO with various waveforms and linear 
-   interpolation.
-   
-   It uses 32-bit fixed-point phase and increment, where the 8 MSB
-   represent the integer part of the number and the 24 LSB the fractionnal part
+   This class implements a table free LFO with various waveforms.
+
+   The phase is normalized to [0..1) and the waveforms are evaluated in
+   closed form (see LfoWaveform). The random waveforms use a per instance
+   pseudo random generator, so renders are reproducible.
    
    @author		Remy Muller
    @date		20030822
@@ -22,19 +22,24 @@ class Lfo
 {
 public:
 
-  /** phase type */
+  /** phase type, normalized [0..1) */
   float phase;
   float result;
   float resultSmooth;
 
-  /**  @param samplerate the samplerate in Hz */
-  Lfo(float samplerate);
+  /**  @param samplerate the samplerate in Hz
+       @param seed seed of the random waveforms */
+  Lfo(float samplerate, unsigned int seed = 22222);
   virtual ~Lfo() {}
 
   /** increments the phase and outputs the new LFO value.
       @return the new LFO value between [-1;+1] */ 
   float tick(int waveform);
 
+  /** advances the LFO by numSamples at once, for control rate updates.
+      @return the new LFO value between [-1;+1] */ 
+  float tick(int waveform, int numSamples);
+
   void resetPhase();
 
   /** change the current rate
@@ -45,36 +50,17 @@ class Lfo
       @param samplerate new samplerate in Hz */
   void setSampleRate(float samplerate_) {samplerate = (samplerate_>0.0) ? samplerate : 44100.0f;}
 
-  /** select the desired waveform for the LFO
-      @param index tag of the waveform
-   */
-  // void setWaveform(waveform_t index);
-  void setWaveform(int index);
-
+  /** phase increment per sample */
   float inc;
 
   float samplerate;
   float randomValue;
-  float randomValueOld;
-
 
 private:
-  OscNoise *noiseOsc;
-  bool freqWrap;
-
-  /** table length is 256+1, with table[0] = table[256] 
-      that way we can perform linear interpolation:
-      \f[ val = (1-frac)*u[n] + frac*u[n+1] \f]
-      even with n = 255.
-      For n higher than 255, n is automatically  wrapped to 0-255*/
-  float tableSin[257]; 
-  float tableTri[257]; 
-  float tableSaw[257]; 
-  float tableRec[257]; 
-  float tableExp[257]; 
-
-  int i;
-  float frac;
+  unsigned int randomState;
+
+  int smoothSamples;
+  float smoothFactor;
 };
 
 #endif	// #ifndef LFO_H
@@ -0,0 +1,233 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__LfoBank_h)
+#define __LfoBank_h
+
+#include "LfoHandler1.h"
+#include "LfoHandler2.h"
+#include "LfoWaveform.h"
+#include "Math.h"
+
+// Per voice state of both LFOs for the polyphonic LFO mode. The settings
+// (rate, waveform, destination, amount) stay in the global handlers, only
+// phase, smoothing and random values live here. The state is stored per
+// LFO as arrays over the voices, so the block update runs the same simple
+// arithmetic over all lanes and vectorizes.
+class LfoBank 
+{
+public:
+	static const int NUM_LFOS = 2;
+
+	// At least the number of voices, padded to a multiple of 4
+	static const int MAX_LANES = 8;
+
+private:
+	float sampleRate;
+	bool isEnabled;
+
+	float phase[NUM_LFOS][MAX_LANES];
+	float value[NUM_LFOS][MAX_LANES];
+	float randomValue[NUM_LFOS][MAX_LANES];
+	unsigned int randomState[NUM_LFOS][MAX_LANES];
+	float rateMultiplier[MAX_LANES];
+
+	int smoothSamples;
+	float smoothFactor;
+
+public:
+	LfoBank(float sampleRate) 
+	{
+		this->sampleRate = sampleRate;
+		this->isEnabled = false;
+		this->smoothSamples = 1;
+		this->smoothFactor = 0.95f;
+
+		for (int lfo = 0; lfo < NUM_LFOS; lfo++)
+		{
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				phase[lfo][i] = 0.0f;
+				value[lfo][i] = 0.0f;
+				randomValue[lfo][i] = 0.0f;
+				randomState[lfo][i] = 22222u + 7919u * (i + lfo * MAX_LANES);
+			}
+		}
+	}
+
+	void setEnabled(bool isEnabled)
+	{
+		this->isEnabled = isEnabled;
+	}
+
+	bool getIsEnabled()
+	{
+		return this->isEnabled;
+	}
+
+	inline float getLfo1(int lane)
+	{
+		return value[0][lane];
+	}
+
+	inline float getLfo2(int lane)
+	{
+		return value[1][lane];
+	}
+
+	// Note on of a voice. Key triggered LFOs restart at their start phase,
+	// free running ones get a random phase so the voices move apart.
+	void triggerPhase(int lane, LfoHandler *lfoHandler1, LfoHandler *lfoHandler2)
+	{
+		triggerPhase(0, lane, lfoHandler1);
+		triggerPhase(1, lane, lfoHandler2);
+	}
+
+	// Phase [0..1], same as LfoHandler::setHostPhase for every lane
+	void setHostPhase(int lfo, const float hostPhase, LfoHandler *lfoHandler)
+	{
+		if (!lfoHandler->getKeyTrigger())
+		{
+			float lanePhase = hostPhase + lfoHandler->getStartPhase();
+			lanePhase -= (int)lanePhase;
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				phase[lfo][i] = lanePhase;
+			}
+		}
+	}
+
+	// Advances all lanes of both LFOs by one control block, LFO 1 first so
+	// the rate modulation happens in the same order as with the global LFOs
+	void process(int numSamples, LfoHandler1 *lfoHandler1, LfoHandler2 *lfoHandler2, bool isHostPlaying)
+	{
+		// Same smoothing as the Lfo class applied numSamples times
+		if (smoothSamples != numSamples)
+		{
+			smoothSamples = numSamples;
+			smoothFactor = powf(0.95f, (float)numSamples);
+		}
+
+		bool isLfo1Locked = lfoHandler1->isPhaseLocked(isHostPlaying);
+		for (int i = 0; i < MAX_LANES; i++)
+		{
+			rateMultiplier[i] = isLfo1Locked ? 1.0f : getRateMultiplier(lfoHandler2->getLfo1(value[1][i]));
+		}
+		processLfo(0, numSamples, lfoHandler1);
+
+		bool isLfo2Locked = lfoHandler2->isPhaseLocked(isHostPlaying);
+		for (int i = 0; i < MAX_LANES; i++)
+		{
+			rateMultiplier[i] = isLfo2Locked ? 1.0f : getRateMultiplier(lfoHandler1->getLfo2(value[0][i]));
+		}
+		processLfo(1, numSamples, lfoHandler2);
+	}
+
+private:
+	// Same mapping as LfoHandler::setRateMultiplier
+	inline float getRateMultiplier(float modulator)
+	{
+		return modulator < 0.0f ? 1.0f + modulator * 0.01f : 1.0f + modulator * 100.0f;
+	}
+
+	void triggerPhase(int lfo, int lane, LfoHandler *lfoHandler)
+	{
+		if (lfoHandler->getKeyTrigger())
+		{
+			phase[lfo][lane] = lfoHandler->getStartPhase() - (int)lfoHandler->getStartPhase();
+		}
+		else if (!lfoHandler->isSync)
+		{
+			phase[lfo][lane] = 0.5f * (LfoWaveform::nextRandom(&randomState[lfo][lane]) + 1.0f);
+		}
+		randomValue[lfo][lane] = LfoWaveform::nextRandom(&randomState[lfo][lane]);
+	}
+
+	void processLfo(int lfo, int numSamples, LfoHandler *lfoHandler)
+	{
+		float *lanePhase = phase[lfo];
+		float *laneValue = value[lfo];
+		float *laneRandom = randomValue[lfo];
+		unsigned int *laneRandomState = randomState[lfo];
+
+		float increment = lfoHandler->getRateHz() * numSamples / sampleRate;
+		float result[MAX_LANES];
+
+		// Same waveforms as the Lfo class, evaluated at the current phase
+		switch (lfoHandler->getWaveform())
+		{
+		case LfoHandler::SIN:
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				result[i] = LfoWaveform::sine(lanePhase[i]);
+			}
+			break;
+		case LfoHandler::TRIANGLE:
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				result[i] = LfoWaveform::triangle(lanePhase[i]);
+			}
+			break;
+		case LfoHandler::SAW:
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				result[i] = LfoWaveform::saw(lanePhase[i]);
+			}
+			break;
+		case LfoHandler::RECTANGE:
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				result[i] = LfoWaveform::rectangle(lanePhase[i]);
+			}
+			break;
+		case LfoHandler::RANDOMSTEP:
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				result[i] = laneRandom[i];
+			}
+			break;
+		case LfoHandler::RANDOM:
+			for (int i = 0; i < MAX_LANES; i++)
+			{
+				result[i] = LfoWaveform::nextRandom(&laneRandomState[i]);
+			}
+			break;
+		}
+
+		for (int i = 0; i < MAX_LANES; i++)
+		{
+			laneValue[i] = result[i] + (laneValue[i] - result[i]) * smoothFactor;
+
+			float nextPhase = lanePhase[i] + increment * rateMultiplier[i];
+			int wraps = (int)nextPhase;
+			lanePhase[i] = nextPhase - wraps;
+
+			// New random step value once per cycle
+			if (wraps > 0)
+			{
+				laneRandom[i] = LfoWaveform::nextRandom(&laneRandomState[i]);
+			}
+		}
+	}
+};
+#endif
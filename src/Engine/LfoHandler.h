@@ -48,6 +48,7 @@ class LfoHandler
     bool keyTrigger;
     float currentRateHz;
     float currentPhase;
+    float syncCyclesPerBeat;
 
     AudioUtils audioUtils;
 
@@ -57,9 +58,10 @@ class LfoHandler
     float amountPositive;
     bool isSync;
 
-    LfoHandler(float sampleRate) 
+    // seed of the random waveforms, different per lfo
+    LfoHandler(float sampleRate, unsigned int seed) 
     {
-        lfo = new Lfo(sampleRate);
+        lfo = new Lfo(sampleRate, seed);
         waveform = SIN;
         value = 0.0f;
         amount = 1.0f;
@@ -67,10 +69,12 @@ class LfoHandler
         isSync = false;
         currentRateHz = 1.0f;
         currentPhase = 0.0f;
+        syncCyclesPerBeat = 1.0f;
     }
 
     ~LfoHandler()
     {
+        delete lfo;
     }
 
     void setWaveform(float waveform)
@@ -114,12 +118,26 @@ class LfoHandler
         }
         else
         {
-            audioUtils.getSyncedRateAndGetText(&rateIn, bpm);
-            currentRateHz = rateIn;
-            this->lfo->setRate(rateIn);
+            syncCyclesPerBeat = audioUtils.getSyncedCyclesPerBeat(rateIn);
+            setTempo(bpm);
         }
     }
 
+    // Host tempo changed, only affects synced lfos
+    void setTempo(const float bpm)
+    {
+        if (isSync)
+        {
+            currentRateHz = syncCyclesPerBeat * bpm / 60.0f;
+            this->lfo->setRate(currentRateHz);
+        }
+    }
+
+    inline float getSyncCyclesPerBeat()
+    {
+        return syncCyclesPerBeat;
+    }
+
     void setAmount(const float amount)
     {
         this->amount = amount;
@@ -136,7 +154,7 @@ class LfoHandler
         if (keyTrigger)
         {
             this->lfo->resetPhase();
-            this->lfo->phase = currentPhase * 255.0f;
+            this->lfo->phase = currentPhase - (int)currentPhase;
         }
     }
 
@@ -145,7 +163,8 @@ class LfoHandler
     {
         if (!keyTrigger)
         {
-            this->lfo->phase = 255.0f * (phase + currentPhase);
+            float lfoPhase = phase + currentPhase;
+            this->lfo->phase = lfoPhase - (int)lfoPhase;
         }
     }
 
@@ -170,11 +189,41 @@ class LfoHandler
         return amount;
     }
 
-    inline float process()
+    inline Waveform getWaveform()
+    {
+        return waveform;
+    }
+
+    inline float getRateHz()
+    {
+        return currentRateHz;
+    }
+
+    inline bool getKeyTrigger()
+    {
+        return keyTrigger;
+    }
+
+    // The phase follows the transport, a rate modulation would be undone
+    // by the next phase correction and only make the phase jump
+    inline bool isPhaseLocked(bool isHostPlaying)
+    {
+        return isSync && !keyTrigger && isHostPlaying;
+    }
+
+    // Phase [0..1]
+    inline float getStartPhase()
+    {
+        return currentPhase;
+    }
+
+    // Advances the lfo by one control block
+    inline float process(int numSamples)
     {
-        return value = lfo->tick(this->waveform);
+        return value = lfo->tick(this->waveform, numSamples);
     }
 
+    // Normalized phase increment per sample
     inline float getLfoInc()
     {
         return lfo->inc;
@@ -45,7 +45,7 @@ class LfoHandler1 : public LfoHandler
 	Destination destination;
 
 public:
-	LfoHandler1(float sampleRate) : LfoHandler(sampleRate)
+	LfoHandler1(float sampleRate) : LfoHandler(sampleRate, 1)
 	{
 		destination = FILTER;
 	}
@@ -60,6 +60,12 @@ class LfoHandler1 : public LfoHandler
 	}
 
 	inline float getFilter()
+	{
+		return getFilter(value);
+	}
+
+	// Overloads taking a value are used by the per voice lfos, value [-1..1]
+	inline float getFilter(float value)
 	{
 		if (destination == FILTER)
 		{
@@ -69,6 +75,11 @@ class LfoHandler1 : public LfoHandler
 	}
 
 	inline float getOsc1Pitch()
+	{
+		return getOsc1Pitch(value);
+	}
+
+	inline float getOsc1Pitch(float value)
 	{
 		if (destination == OSC1PITCH)
 		{
@@ -78,6 +89,11 @@ class LfoHandler1 : public LfoHandler
 	}
 
 	inline float getOsc2Pitch()
+	{
+		return getOsc2Pitch(value);
+	}
+
+	inline float getOsc2Pitch(float value)
 	{
 		if (destination == OSC2PITCH)
 		{
@@ -87,6 +103,11 @@ class LfoHandler1 : public LfoHandler
 	}
 
 	inline float getFm()
+	{
+		return getFm(value);
+	}
+
+	inline float getFm(float value)
 	{
 		if (destination == FM)
 		{
@@ -96,6 +117,11 @@ class LfoHandler1 : public LfoHandler
 	}
 
 	inline float getPw()
+	{
+		return getPw(value);
+	}
+
+	inline float getPw(float value)
 	{
 		if (destination == PW)
 		{
@@ -105,6 +131,11 @@ class LfoHandler1 : public LfoHandler
 	}
 
 	inline float getLfo2()
+	{
+		return getLfo2(value);
+	}
+
+	inline float getLfo2(float value)
 	{
 		if (destination == LFO2RATE)
 		{
@@ -45,7 +45,7 @@ class LfoHandler2 : public LfoHandler
 	Destination destination;
 
 public:
-	LfoHandler2(float sampleRate) : LfoHandler(sampleRate)
+	LfoHandler2(float sampleRate) : LfoHandler(sampleRate, 2)
 	{
 		destination = FILTER;
 	}
@@ -65,6 +65,12 @@ class LfoHandler2 : public LfoHandler
 	}
 
 	inline float getFilter()
+	{
+		return getFilter(value);
+	}
+
+	// Overloads taking a value are used by the per voice lfos, value [-1..1]
+	inline float getFilter(float value)
 	{
 		if (destination == FILTER)
 		{
@@ -74,6 +80,11 @@ class LfoHandler2 : public LfoHandler
 	}
 
 	inline float getOsc1Pitch()
+	{
+		return getOsc1Pitch(value);
+	}
+
+	inline float getOsc1Pitch(float value)
 	{
 		if (destination == OSC1PITCH)
 		{
@@ -83,6 +94,11 @@ class LfoHandler2 : public LfoHandler
 	}
 
 	inline float getOsc2Pitch()
+	{
+		return getOsc2Pitch(value);
+	}
+
+	inline float getOsc2Pitch(float value)
 	{
 		if (destination == OSC2PITCH)
 		{
@@ -92,6 +108,11 @@ class LfoHandler2 : public LfoHandler
 	}
 
 	inline float getVolume()
+	{
+		return getVolume(value);
+	}
+
+	inline float getVolume(float value)
 	{
 		if (destination == VOLUME)
 		{
@@ -101,6 +122,11 @@ class LfoHandler2 : public LfoHandler
 	}
 
 	inline float getPan()
+	{
+		return getPan(value);
+	}
+
+	inline float getPan(float value)
 	{
 		if (destination == PAN)
 		{
@@ -110,6 +136,11 @@ class LfoHandler2 : public LfoHandler
 	}
 
 	inline float getLfo1()
+	{
+		return getLfo1(value);
+	}
+
+	inline float getLfo1(float value)
 	{
 		if (destination == LFO1RATE)
 		{
@@ -0,0 +1,72 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__LfoWaveform_h)
+#define __LfoWaveform_h
+
+#include "Math.h"
+
+// Closed form lfo shapes of a normalized phase [0..1), output [-1..1].
+// No tables and no branches, so they vectorize when evaluated over
+// several lfos at once (see LfoBank).
+class LfoWaveform
+{
+public:
+	// Parabolic approximation with one correction step, max error about 0.001
+	static inline float sine(float phase)
+	{
+		float x = 0.5f - phase;
+		float y = 8.0f * x * (1.0f - 2.0f * fabsf(x));
+		return 0.225f * (y * fabsf(y) - y) + y;
+	}
+
+	// Starts at 0 rising, like the sine
+	static inline float triangle(float phase)
+	{
+		float x = phase + 0.75f;
+		x -= (int)x;
+		return 4.0f * fabsf(x - 0.5f) - 1.0f;
+	}
+
+	static inline float saw(float phase)
+	{
+		return 2.0f * phase - 1.0f;
+	}
+
+	static inline float rectangle(float phase)
+	{
+		return 1.0f - 2.0f * (float)(int)(2.0f * phase);
+	}
+
+	// xorshift32, deterministic for a given seed. Output [-1..1]
+	static inline float nextRandom(unsigned int *state)
+	{
+		unsigned int x = *state;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		*state = x;
+		return (float)(x >> 8) * (2.0f / 16777216.0f) - 1.0f;
+	}
+};
+#endif
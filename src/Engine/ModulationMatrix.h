@@ -0,0 +1,213 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__ModulationMatrix_h)
+#define __ModulationMatrix_h
+
+#include "Math.h"
+
+// Free routing of modulation sources to voice destinations. The slots are
+// compiled into a flat list of the active routings whenever a slot changes,
+// so unused slots cost nothing. Voices evaluate the list once per control
+// block.
+class ModulationMatrix 
+{
+public:
+	static const int NUM_SLOTS = 8;
+
+	// source, destination, amount, curve
+	static const int PARAMETERS_PER_SLOT = 4;
+
+	enum Source
+	{
+		SOURCE_OFF = 0,
+		SOURCE_LFO1,
+		SOURCE_LFO2,
+		SOURCE_FREEAD,
+		SOURCE_FILTERENVELOPE,
+		SOURCE_AMPENVELOPE,
+		SOURCE_VELOCITY,
+		SOURCE_KEY,
+		SOURCE_PITCHWHEEL,
+		SOURCE_MODWHEEL,
+		SOURCE_AFTERTOUCH,
+		SOURCE_CHANNELPRESSURE,
+		SOURCE_SLIDE,
+		NUM_SOURCES
+	};
+
+	enum Destination
+	{
+		DESTINATION_OFF = 0,
+		DESTINATION_CUTOFF,
+		DESTINATION_RESONANCE,
+		DESTINATION_PITCH,
+		DESTINATION_OSC1PITCH,
+		DESTINATION_OSC2PITCH,
+		DESTINATION_PW,
+		DESTINATION_FM,
+		DESTINATION_PAN,
+		DESTINATION_VOLUME,
+		DESTINATION_REVERBSEND,
+		NUM_DESTINATIONS
+	};
+
+	enum Curve
+	{
+		CURVE_LINEAR = 0,
+		CURVE_EXPONENTIAL,
+		CURVE_LOGARITHMIC,
+		NUM_CURVES
+	};
+
+private:
+	struct Routing
+	{
+		Source source;
+		Destination destination;
+		Curve curve;
+		float amount;
+	};
+
+	Routing slots[NUM_SLOTS];
+
+	// Active slots with the amount scaled to the destination range
+	Routing routings[NUM_SLOTS];
+	int numRoutings;
+
+	bool isDestinationUsed[NUM_DESTINATIONS];
+
+	// Full range of a destination for an amount of 1
+	float destinationScale[NUM_DESTINATIONS];
+
+public:
+	ModulationMatrix() 
+	{
+		for (int i = 0; i < NUM_SLOTS; i++)
+		{
+			slots[i].source = SOURCE_OFF;
+			slots[i].destination = DESTINATION_OFF;
+			slots[i].curve = CURVE_LINEAR;
+			slots[i].amount = 0.0f;
+		}
+
+		for (int i = 0; i < NUM_DESTINATIONS; i++)
+		{
+			destinationScale[i] = 1.0f;
+		}
+		destinationScale[DESTINATION_PITCH] = 24.0f;
+		destinationScale[DESTINATION_OSC1PITCH] = 24.0f;
+		destinationScale[DESTINATION_OSC2PITCH] = 24.0f;
+		destinationScale[DESTINATION_PW] = 0.5f;
+
+		compile();
+	}
+
+	// index: slot * PARAMETERS_PER_SLOT + parameter, value [0..1]
+	void setParameter(int index, float value)
+	{
+		int slot = index / PARAMETERS_PER_SLOT;
+		if (slot < 0 || slot >= NUM_SLOTS) return;
+
+		switch (index % PARAMETERS_PER_SLOT)
+		{
+		case 0: slots[slot].source = (Source)getIndex(value, NUM_SOURCES); break;
+		case 1: slots[slot].destination = (Destination)getIndex(value, NUM_DESTINATIONS); break;
+		case 2: slots[slot].amount = (value - 0.5f) * 2.0f; break;
+		case 3: slots[slot].curve = (Curve)getIndex(value, NUM_CURVES); break;
+		}
+		compile();
+	}
+
+	bool hasRoutings()
+	{
+		return numRoutings > 0;
+	}
+
+	bool isUsed(Destination destination)
+	{
+		return isDestinationUsed[destination];
+	}
+
+	// sources: NUM_SOURCES values [-1..1], destinations: NUM_DESTINATIONS sums
+	inline void process(const float *sources, float *destinations)
+	{
+		for (int i = 0; i < NUM_DESTINATIONS; i++)
+		{
+			destinations[i] = 0.0f;
+		}
+
+		for (int i = 0; i < numRoutings; i++)
+		{
+			const Routing &routing = routings[i];
+			float value = sources[routing.source];
+
+			switch (routing.curve)
+			{
+			case CURVE_EXPONENTIAL:
+				value = value * fabsf(value);
+				break;
+			case CURVE_LOGARITHMIC:
+				value = value < 0.0f ? -sqrtf(-value) : sqrtf(value);
+				break;
+			default:
+				break;
+			}
+			destinations[routing.destination] += value * routing.amount;
+		}
+	}
+
+private:
+	int getIndex(float value, int numValues)
+	{
+		int index = (int)(value * (numValues - 1) + 0.5f);
+		if (index < 0) index = 0;
+		if (index >= numValues) index = numValues - 1;
+		return index;
+	}
+
+	// Only slots with a source, a destination and an amount end up in the list
+	void compile()
+	{
+		for (int i = 0; i < NUM_DESTINATIONS; i++)
+		{
+			isDestinationUsed[i] = false;
+		}
+
+		int count = 0;
+		for (int i = 0; i < NUM_SLOTS; i++)
+		{
+			if (slots[i].source != SOURCE_OFF && slots[i].destination != DESTINATION_OFF && slots[i].amount != 0.0f)
+			{
+				routings[count].source = slots[i].source;
+				routings[count].destination = slots[i].destination;
+				routings[count].curve = slots[i].curve;
+				routings[count].amount = slots[i].amount * destinationScale[slots[i].destination];
+				isDestinationUsed[slots[i].destination] = true;
+				count++;
+			}
+		}
+		numRoutings = count;
+	}
+};
+#endif
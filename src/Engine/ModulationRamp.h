@@ -21,33 +21,47 @@
 	==============================================================================
  */
 
-#if !defined(__ParamChangeUtil_h)
-#define __ParamChangeUtil_h
+#if !defined(__ModulationRamp_h)
+#define __ModulationRamp_h
 
-#include "Math.h"
-
-// Low pass filter for gentle parameter changes
-class ParamChangeUtil
+// Modulation values are calculated once per control block. The ramp moves
+// linearly from the last value to the new target over the block, so the
+// audio rate code gets smooth values without evaluating the sources.
+class ModulationRamp 
 {
 private:
-	float paramWeight;
-	float paramWeigthInverse;
+	float value;
+	float step;
 
 public:
-	float currentValue;
+	ModulationRamp()
+	{
+		value = 0.0f;
+		step = 0.0f;
+	}
+
+	// Reaches the target after numSamples ticks
+	inline void setTarget(const float target, const float inverseNumSamples)
+	{
+		step = (target - value) * inverseNumSamples;
+	}
+
+	// No ramp, for example at the start of a note
+	inline void jumpTo(const float target)
+	{
+		value = target;
+		step = 0.0f;
+	}
 
-	// param weight should be bigger than 1
-	ParamChangeUtil(float sampleRate, float paramWeight)
+	inline float tick()
 	{
-		currentValue = 0;
-		this->paramWeight = paramWeight * sampleRate / 44100.0f;
-		paramWeigthInverse = 1.0f / (this->paramWeight + 1.0f);
+		value += step;
+		return value;
 	}
 
-	inline float tick(float input)
+	inline float getValue()
 	{
-		currentValue = (paramWeight * currentValue + input) * paramWeigthInverse;
-		return currentValue;
+		return value;
 	}
 };
 #endif
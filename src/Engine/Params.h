@@ -114,6 +114,21 @@ enum SYNTHPARAMETERS
 
     HIGHPASS,
     DETUNE,
+    SILENCETHRESHOLD,
+    FILTER2TYPE,
+    FILTER2CUTOFF,
+    FILTER2RESONANCE,
+    FILTERROUTING,
+    LFOPERVOICE,
+    MPEMODE,
+    GLIDEMODE,
+    VELOCITYCURVE,
+    KEYFOLLOWCURVE,
+    REVERBMODE,
+
+    // Modulation matrix, 8 slots of source, destination, amount and curve
+    MODMATRIX,
+    MODMATRIXLAST = MODMATRIX + 31,
 
 	PANIC,
 	MIDILEARN,
@@ -72,5 +72,11 @@ class PitchwheelHandler
     {
         return this->cutoff * amount;
     }
+
+    // Wheel position [-1..1]
+    inline float getPosition()
+    {
+        return this->amount;
+    }
 };
 #endif
\ No newline at end of file
@@ -24,11 +24,32 @@
 #if !defined(__PORTAMENTO_h)
 #define __PORTAMENTO_h
 
+#include "Math.h"
+
+// Glide in note units, which are linear in log frequency. The speed is
+// computed when the parameter changes and the glide advances once per
+// control block, the voice interpolates between the block end values.
 class Portamento 
 {
+public:
+	enum GlideMode
+	{
+		CONSTANT_RATE = 0, // same speed in semitones per second for every interval
+		CONSTANT_TIME      // every interval takes as long as an octave at that rate
+	};
+
 private:
 	float portamentoSampleRate;
 	float slideValue;
+	float destValue;
+
+	GlideMode glideMode;
+
+	// Semitones per sample of the constant rate glide
+	float speed;
+
+	// Semitones per sample of the current glide
+	float step;
 
 public:
 
@@ -36,47 +57,87 @@ class Portamento
 	{
 		portamentoSampleRate= sampleRate / 44100.0f;
 		slideValue = 42;
+		destValue = 42;
+		glideMode = CONSTANT_RATE;
+		setSpeed(0.0f);
 	}
 
-	inline float tick(float destValue, float portamentoValue, bool portamentoOn) 
+	// portamentoValue [0..1]
+	void setSpeed(float portamentoValue)
 	{
-		if (portamentoOn)
+		speed= (0.11f - (portamentoValue*0.1f)) * portamentoSampleRate;
+		speed= speed*speed*speed*speed*speed*speed + 0.00000001f;
+		speed*= 10000.0f;
+		updateStep();
+	}
+
+	void setGlideMode(GlideMode glideMode)
+	{
+		this->glideMode = glideMode;
+		updateStep();
+	}
+
+	// Advances the glide by numSamples, returns the note at the end
+	inline float process(float destValue, bool portamentoOn, int numSamples) 
+	{
+		if (!portamentoOn)
 		{
-			float speed= (0.11f - (portamentoValue*0.1f)) * portamentoSampleRate;
-			speed= speed*speed*speed*speed*speed*speed + 0.00000001f;
-			speed*= 10000.0f;
-			if (slideValue > destValue)
-			{
-				slideValue -= speed;
-				if (slideValue < destValue)
-				{
-					slideValue = destValue;
-				}
-			}
-			else if (slideValue < destValue)
-			{
-				slideValue += speed;
-				if (slideValue > destValue)
-				{
-					slideValue = destValue;
-				}
-			}
-			else
+			this->destValue = destValue;
+			slideValue = destValue;
+			return slideValue;
+		}
+
+		if (destValue != this->destValue)
+		{
+			this->destValue = destValue;
+			updateStep();
+		}
+
+		float distance = step * numSamples;
+		if (slideValue > destValue)
+		{
+			slideValue -= distance;
+			if (slideValue < destValue)
 			{
 				slideValue = destValue;
 			}
 		}
-		else
+		else if (slideValue < destValue)
 		{
-			slideValue = destValue; 
+			slideValue += distance;
+			if (slideValue > destValue)
+			{
+				slideValue = destValue;
+			}
 		}
 		return slideValue;
 	}
 
+	inline float getValue()
+	{
+		return slideValue;
+	}
+
 	// portamentoMode (0=off, 1=auto, 2=on)
 	inline void setUpNote(float newNote)
 	{
 		slideValue = newNote;
+		destValue = newNote;
+	}
+
+private:
+	void updateStep()
+	{
+		if (glideMode == CONSTANT_TIME)
+		{
+			// Octave time of the constant rate glide for the remaining interval
+			step = fabsf(destValue - slideValue) * speed / 12.0f;
+			if (step <= 0.0f) step = speed;
+		}
+		else
+		{
+			step = speed;
+		}
 	}
 };
 #endif
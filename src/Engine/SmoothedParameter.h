@@ -0,0 +1,192 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__SmoothedParameter_h)
+#define __SmoothedParameter_h
+
+#include "Math.h"
+
+// Parameter value that follows changes with a linear or exponential ramp.
+// Once the target is reached it reports settled, so the caller can skip
+// the per sample work and use a constant.
+class SmoothedParameter 
+{
+public:
+	enum Mode
+	{
+		LINEAR = 0,
+		EXPONENTIAL
+	};
+
+private:
+	Mode mode;
+	float value;
+	float target;
+	bool isInitialized;
+
+	// LINEAR: samples of a full ramp, EXPONENTIAL: time constant in samples
+	float rampSamples;
+
+	float step;
+	int stepsLeft;
+	float coefficient;
+
+	int blockSamples;
+	float blockCoefficient;
+
+	// Stops the exponential approach once it is close enough for
+	// normalized values or float resolution stalls it
+	inline void approach(float next)
+	{
+		value = (next == value || fabsf(target - next) < 1.0e-5f) ? target : next;
+	}
+
+public:
+	SmoothedParameter() 
+	{
+		this->mode = LINEAR;
+		this->value = 0.0f;
+		this->target = 0.0f;
+		this->isInitialized = false;
+		this->rampSamples = 1.0f;
+		this->step = 0.0f;
+		this->stepsLeft = 0;
+		this->coefficient = 1.0f;
+		this->blockSamples = 0;
+		this->blockCoefficient = 1.0f;
+	}
+
+	// initialValue is used until the first target is set
+	void initialize(float sampleRate, float seconds, Mode mode, float initialValue)
+	{
+		this->mode = mode;
+		this->value = initialValue;
+		this->target = initialValue;
+		this->isInitialized = false;
+		this->stepsLeft = 0;
+		this->rampSamples = sampleRate * seconds;
+		if (this->rampSamples < 1.0f) this->rampSamples = 1.0f;
+		this->coefficient = 1.0f / (this->rampSamples + 1.0f);
+		this->blockSamples = 0;
+	}
+
+	// The first target after construction is taken over without a ramp
+	void setTarget(float target)
+	{
+		if (!isInitialized)
+		{
+			jumpTo(target);
+			return;
+		}
+
+		this->target = target;
+		if (mode == LINEAR)
+		{
+			stepsLeft = (int)rampSamples;
+			step = (target - value) / stepsLeft;
+		}
+	}
+
+	void jumpTo(float target)
+	{
+		this->isInitialized = true;
+		this->target = target;
+		this->value = target;
+		this->stepsLeft = 0;
+	}
+
+	inline bool isSettled()
+	{
+		return value == target;
+	}
+
+	inline float getValue()
+	{
+		return value;
+	}
+
+	inline float getTarget()
+	{
+		return target;
+	}
+
+	inline float tick()
+	{
+		if (mode == LINEAR)
+		{
+			if (stepsLeft > 0)
+			{
+				value = --stepsLeft > 0 ? value + step : target;
+			}
+		}
+		else if (value != target)
+		{
+			approach(value + (target - value) * coefficient);
+		}
+		return value;
+	}
+
+	// Renders numSamples values. Returns false without touching output if
+	// the value is settled, output is then constant getValue().
+	inline bool process(float *output, int numSamples)
+	{
+		if (isSettled())
+		{
+			return false;
+		}
+		for (int i = 0; i < numSamples; i++)
+		{
+			output[i] = tick();
+		}
+		return true;
+	}
+
+	// Advances by numSamples at once for parameters applied at control rate
+	inline float advance(int numSamples)
+	{
+		if (mode == LINEAR)
+		{
+			if (stepsLeft > numSamples)
+			{
+				stepsLeft -= numSamples;
+				value += step * numSamples;
+			}
+			else
+			{
+				stepsLeft = 0;
+				value = target;
+			}
+		}
+		else if (value != target)
+		{
+			if (blockSamples != numSamples)
+			{
+				blockSamples = numSamples;
+				blockCoefficient = 1.0f - powf(1.0f - coefficient, (float)numSamples);
+			}
+			approach(value + (target - value) * blockCoefficient);
+		}
+		return value;
+	}
+};
+#endif
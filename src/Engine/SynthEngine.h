@@ -28,35 +28,91 @@
 #include "Params.h"
 #include "SynthVoice.h"
 #include "VoiceManager.h"
-#include "ParamChangeUtil.h"
+#include "SmoothedParameter.h"
 #include "LfoHandler1.h"
 #include "LfoHandler2.h"
+#include "LfoBank.h"
+#include "TransportClock.h"
 #include "PitchwheelHandler.h"
 #include "VelocityHandler.h"
 #include "HighPass.h"
 #include "StereoPan.h"
+#include "ModulationRamp.h"
+#include "ModulationMatrix.h"
 #include "../Effects/Chorus/ChorusEngine.h"
 #include "../Effects/Reverb/ReverbEngine.h"
 
 class SynthEngine 
 {
+public:
+	// Upper limit for the control block size in samples, the voices
+	// render their envelopes per control block
+	static const int MAX_CONTROL_RATE = Adsr::MAX_BLOCK_SIZE;
+
 private:
     float sampleRate;
+	int controlRate;
 
-	float volume;
-	float cutoff;
 
 	VoiceManager* voiceManager;
-	ParamChangeUtil *cutoffFiltered;
 	LfoHandler1 *lfoHandler1;
 	LfoHandler2 *lfoHandler2;
+	LfoBank *lfoBank;
+	TransportClock *transportClock;
 
     PitchwheelHandler *pitchwheelHandler;
     VelocityHandler *velocityHandler;
+    ModulationMatrix *modulationMatrix;
 
     HighPass *highPass;
+    HighPass *highPassR;
     StereoPan *stereoPan;
 
+	float cutoffValues[MAX_CONTROL_RATE];
+	float reverbSendL[MAX_CONTROL_RATE];
+	float reverbSendR[MAX_CONTROL_RATE];
+	ModulationRamp volumeRamp;
+	ModulationRamp panRamp;
+
+	// Continuous parameters, smoothed and applied once per control block
+	enum SmoothedParameterId
+	{
+		SMOOTHED_OSC1VOLUME = 0,
+		SMOOTHED_OSC2VOLUME,
+		SMOOTHED_OSC3VOLUME,
+		SMOOTHED_RESONANCE,
+		SMOOTHED_KEYFOLLOW,
+		SMOOTHED_FILTERCONTOUR,
+		SMOOTHED_OSC1PW,
+		SMOOTHED_OSC1FM,
+		SMOOTHED_RINGMODULATION,
+		SMOOTHED_DETUNE,
+		SMOOTHED_MASTERTUNE,
+		SMOOTHED_FREEADAMOUNT,
+		SMOOTHED_LFO1AMOUNT,
+		SMOOTHED_LFO2AMOUNT,
+		SMOOTHED_HIGHPASS,
+		SMOOTHED_FILTER2CUTOFF,
+		SMOOTHED_FILTER2RESONANCE,
+		SMOOTHED_REVERBWET,
+		NUM_SMOOTHED_PARAMETERS
+	};
+	SmoothedParameter smoothedParameters[NUM_SMOOTHED_PARAMETERS];
+
+	// Smoothed per sample
+	SmoothedParameter cutoffSmoothed;
+	SmoothedParameter volumeSmoothed;
+	float volumeValues[MAX_CONTROL_RATE];
+
+	static const int MPE_MASTER_CHANNEL = 1;
+	static const int MPE_NUM_CHANNELS = 16;
+	bool isMpeMode;
+
+	// Last controller values per member channel, index is the midi channel
+	float mpePitchbend[MPE_NUM_CHANNELS + 1];
+	float mpeSlide[MPE_NUM_CHANNELS + 1];
+	float mpePressure[MPE_NUM_CHANNELS + 1];
+
     ChorusEngine *chorusEngine;
     ReverbEngine *reverbEngine;
 
@@ -68,13 +124,16 @@ class SynthEngine
 	{
 		Params *params= new Params();
 		this->param= params->parameters;
+
+        // Their buffers are allocated by allocateEffectBuffers
+        this->chorusEngine = new ChorusEngine(sampleRate);
+        this->reverbEngine = new ReverbEngine(sampleRate);
 		initialize(sampleRate);
 	}
 
 	~SynthEngine()
 	{
-		delete cutoffFiltered;
-		delete voiceManager;
+		release();
         delete chorusEngine;
         delete reverbEngine;
 	}
@@ -83,22 +142,47 @@ class SynthEngine
 	void initialize(float sampleRate)
 	{
         this->sampleRate = sampleRate;
-		this->cutoff = 1.0f;
-		this->volume = 1.0f;
-
-		cutoffFiltered = new ParamChangeUtil(sampleRate, 1000.0f);
+		this->controlRate = 16;
+		this->volumeRamp.jumpTo(1.0f);
+		this->isMpeMode = false;
+		this->resetMpeChannels();
+
+		// Same time constant as the former cutoff low pass
+		cutoffSmoothed.initialize(sampleRate, 1000.0f / 44100.0f, SmoothedParameter::EXPONENTIAL, 1.0f);
+		volumeSmoothed.initialize(sampleRate, 0.02f, SmoothedParameter::LINEAR, 1.0f);
+		for (int i = 0; i < NUM_SMOOTHED_PARAMETERS; i++)
+		{
+			smoothedParameters[i].initialize(sampleRate, 0.02f, SmoothedParameter::LINEAR, 0.0f);
+		}
 
 		lfoHandler1 = new LfoHandler1(sampleRate);
 		lfoHandler2 = new LfoHandler2(sampleRate);
+		lfoBank = new LfoBank(sampleRate);
+		transportClock = new TransportClock(sampleRate);
         pitchwheelHandler = new PitchwheelHandler(sampleRate);
         velocityHandler = new VelocityHandler(sampleRate);
+        modulationMatrix = new ModulationMatrix();
 
         highPass = new HighPass();
+        highPassR = new HighPass();
         this->stereoPan = new StereoPan();
 
-        this->chorusEngine = new ChorusEngine(sampleRate);
-        this->reverbEngine = new ReverbEngine(sampleRate);
-		voiceManager = new VoiceManager(sampleRate, lfoHandler1, lfoHandler2, velocityHandler, pitchwheelHandler);
+		voiceManager = new VoiceManager(sampleRate, lfoHandler1, lfoHandler2, lfoBank, velocityHandler, pitchwheelHandler, modulationMatrix);
+	}
+
+	void release()
+	{
+		delete voiceManager;
+		delete lfoHandler1;
+		delete lfoHandler2;
+		delete lfoBank;
+		delete transportClock;
+		delete pitchwheelHandler;
+		delete velocityHandler;
+		delete modulationMatrix;
+		delete highPass;
+		delete highPassR;
+		delete stereoPan;
 	}
 
 	Osc::Waveform getOsc1Waveform(float value)
@@ -145,10 +229,108 @@ class SynthEngine
 		return waveform;
 	}
 
+	FilterHandler::Routing getFilterRouting(float value)
+	{
+		FilterHandler::Routing routing;
+
+		float valueSize = 1.0f / 3.0f - 0.001f;
+		if (value < valueSize)
+		{
+			routing = FilterHandler::SERIAL;
+		}
+		else if (value < valueSize * 2.0f)
+		{
+			routing = FilterHandler::PARALLEL;
+		}
+		else
+		{
+			routing = FilterHandler::STEREO;
+		}
+		return routing;
+	}
+
 public:
+	// The effects keep their buffers if they fit the new sample rate
 	void setSampleRate (float sampleRate)
 	{
+		release();
 		initialize(sampleRate);
+        this->chorusEngine->setSampleRate(sampleRate);
+        this->reverbEngine->setSampleRate(sampleRate);
+	}
+
+	// Effect buffers are allocated when an effect gets enabled and released
+	// after it has been idle for seconds. isUsed is false if the effects are
+	// not rendered at all, like on a shared effect bus the instance does not
+	// own. Call with the audio thread locked, it reads the effect state for
+	// allocateEffectBuffers.
+	void updateEffectAllocation(bool isUsed)
+	{
+		this->chorusEngine->updateAllocation(isUsed);
+		this->reverbEngine->updateAllocation(isUsed);
+	}
+
+	// Call from a non audio thread after updateEffectAllocation, returns true
+	// if swapEffectBuffers has to be called with the audio thread locked,
+	// then freeEffectBuffers.
+	bool allocateEffectBuffers()
+	{
+		bool isChorusSwapPending = this->chorusEngine->allocateBuffers();
+		bool isReverbSwapPending = this->reverbEngine->allocateBuffers();
+		return isChorusSwapPending || isReverbSwapPending;
+	}
+
+	void swapEffectBuffers()
+	{
+		this->chorusEngine->swapBuffers();
+		this->reverbEngine->swapBuffers();
+	}
+
+	void freeEffectBuffers()
+	{
+		this->chorusEngine->freeBuffers();
+		this->reverbEngine->freeBuffers();
+	}
+
+	// All four steps, if nothing else renders the engine at the same time
+	void updateEffectBuffers()
+	{
+		updateEffectAllocation(true);
+		if (allocateEffectBuffers())
+		{
+			swapEffectBuffers();
+		}
+		freeEffectBuffers();
+	}
+
+	void setEffectReleaseTime(float seconds)
+	{
+		this->chorusEngine->setReleaseTime(seconds);
+		this->reverbEngine->setReleaseTime(seconds);
+	}
+
+	// Samples per control block, modulation sources are evaluated once per block
+	void setControlRate(int controlRate)
+	{
+		if (controlRate < 1) controlRate = 1;
+		if (controlRate > MAX_CONTROL_RATE) controlRate = MAX_CONTROL_RATE;
+		this->controlRate = controlRate;
+	}
+
+	int getControlRate()
+	{
+		return this->controlRate;
+	}
+
+	// index: slot * ModulationMatrix::PARAMETERS_PER_SLOT + parameter
+	void setModulationMatrix(int index, float value)
+	{
+		this->modulationMatrix->setParameter(index, value);
+	}
+
+	void setLfoPerVoice(float value)
+	{
+		this->lfoBank->setEnabled(value > 0.0f);
 	}
 
 	void setNumberOfVoices(int numberOfVoices)
@@ -156,22 +338,202 @@ class SynthEngine
 		this->voiceManager->setNumberOfVoices(numberOfVoices);
 	}
 
-	void setNoteOn(int note, float velocity)
+	// channel [1..16]
+	void setNoteOn(int note, float velocity, int channel)
 	{
-		voiceManager->setNoteOn(note, velocity);
+		int voiceChannel = getVoiceChannel(channel);
+		SynthVoice *voice = voiceManager->setNoteOn(note, velocity, voiceChannel);
+
+		// Mpe controllers sent before the note on apply to the new note
+		voice->setExpression(SynthVoice::EXPRESSION_PITCHBEND, voiceChannel > 0 ? mpePitchbend[voiceChannel] : 0.0f);
+		voice->setExpression(SynthVoice::EXPRESSION_SLIDE, voiceChannel > 0 ? mpeSlide[voiceChannel] : 0.0f);
+		if (voiceChannel > 0)
+		{
+			voice->setExpression(SynthVoice::EXPRESSION_CHANNELPRESSURE, mpePressure[voiceChannel]);
+		}
 	}
 
-	void setNoteOff(int note)
+	void setNoteOff(int note, int channel)
 	{
-		voiceManager->setNoteOff(note);
+		voiceManager->setNoteOff(note, getVoiceChannel(channel));
+	}
+
+	// channel [1..16], value [0..1]
+	void setAftertouch(int note, int channel, float value)
+	{
+		voiceManager->setAftertouch(note, getVoiceChannel(channel), value);
+	}
+
+	// value [-1..1], per note pitch bend on mpe member channels
+	void setPitchwheel(int channel, float value)
+	{
+		int voiceChannel = getVoiceChannel(channel);
+		if (voiceChannel > 0)
+		{
+			mpePitchbend[voiceChannel] = value;
+			voiceManager->setChannelExpression(voiceChannel, SynthVoice::EXPRESSION_PITCHBEND, value);
+		}
+		else
+		{
+			setPitchwheelAmount(value);
+		}
+	}
+
+	// value [0..1], per note pressure on mpe member channels
+	void setChannelPressure(int channel, float value)
+	{
+		int voiceChannel = getVoiceChannel(channel);
+		if (voiceChannel > 0)
+		{
+			mpePressure[voiceChannel] = value;
+			voiceManager->setChannelExpression(voiceChannel, SynthVoice::EXPRESSION_CHANNELPRESSURE, value);
+		}
+		else
+		{
+			setExpression(SynthVoice::EXPRESSION_CHANNELPRESSURE, value);
+		}
+	}
+
+	// value [0..1], mpe timbre (cc 74), only used in mpe mode
+	void setSlide(int channel, float value)
+	{
+		int voiceChannel = getVoiceChannel(channel);
+		if (voiceChannel > 0)
+		{
+			mpeSlide[voiceChannel] = value;
+			voiceManager->setChannelExpression(voiceChannel, SynthVoice::EXPRESSION_SLIDE, value);
+		}
+	}
+
+	bool getMpeMode()
+	{
+		return this->isMpeMode;
+	}
+
+	void setMpeMode(float value)
+	{
+		bool isMpeMode = value > 0.0f;
+		if (isMpeMode != this->isMpeMode)
+		{
+			// Held notes were started on the other channel mapping, their
+			// note offs would not find them anymore
+			voiceManager->reset();
+			this->isMpeMode = isMpeMode;
+			this->resetMpeChannels();
+		}
+	}
+
+	// value [0..1]
+	void setModWheel(float value)
+	{
+		setExpression(SynthVoice::EXPRESSION_MODWHEEL, value);
+	}
+
+	void setExpression(SynthVoice::Expression expression, float value)
+	{
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setExpression(expression, value);
+		}
 	}
 
 	void setVolume(float value)
 	{
-		this->volume = audioUtils.getLogScaledVolume(value, 2.0f);
+		this->volumeSmoothed.setTarget(audioUtils.getLogScaledVolume(value, 2.0f));
 	}
 
 	void setOsc1Volume(float value)
+	{
+		setSmoothedParameter(SMOOTHED_OSC1VOLUME, value);
+	}
+
+	void setOsc2Volume(float value)
+	{
+		setSmoothedParameter(SMOOTHED_OSC2VOLUME, value);
+	}
+
+	void setOsc3Volume(float value)
+	{
+		setSmoothedParameter(SMOOTHED_OSC3VOLUME, value);
+	}
+
+	void setResonance(float value)
+	{
+		setSmoothedParameter(SMOOTHED_RESONANCE, value);
+	}
+
+	void setKeyfollow(float value)
+	{
+		setSmoothedParameter(SMOOTHED_KEYFOLLOW, value);
+	}
+
+	void setFilterContour(float value)
+	{
+		setSmoothedParameter(SMOOTHED_FILTERCONTOUR, value);
+	}
+
+	void setOsc1Pw(float value)
+	{
+		setSmoothedParameter(SMOOTHED_OSC1PW, value);
+	}
+
+	void setOsc1Fm(float value)
+	{
+		setSmoothedParameter(SMOOTHED_OSC1FM, value);
+	}
+
+	void setRingmodulation(float value)
+	{
+		setSmoothedParameter(SMOOTHED_RINGMODULATION, value);
+	}
+
+	void setDetune(float value)
+	{
+		setSmoothedParameter(SMOOTHED_DETUNE, value);
+	}
+
+	void setMastertune(float value)
+	{
+		setSmoothedParameter(SMOOTHED_MASTERTUNE, value);
+	}
+
+	void setFreeAdAmount(float value)
+	{
+		setSmoothedParameter(SMOOTHED_FREEADAMOUNT, value);
+	}
+
+	void setLfo1Amount(float value)
+	{
+		setSmoothedParameter(SMOOTHED_LFO1AMOUNT, value);
+	}
+
+	void setLfo2Amount(float value)
+	{
+		setSmoothedParameter(SMOOTHED_LFO2AMOUNT, value);
+	}
+
+	void setHighPass(float value)
+	{
+		setSmoothedParameter(SMOOTHED_HIGHPASS, value);
+	}
+
+	void setFilter2Cutoff(float value)
+	{
+		setSmoothedParameter(SMOOTHED_FILTER2CUTOFF, value);
+	}
+
+	void setFilter2Resonance(float value)
+	{
+		setSmoothedParameter(SMOOTHED_FILTER2RESONANCE, value);
+	}
+
+	void setReverbWet(float value)
+	{
+		setSmoothedParameter(SMOOTHED_REVERBWET, value);
+	}
+
+	void applyOsc1Volume(float value)
 	{
 		value = audioUtils.getLogScaledVolume(value, 1.0f);
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -181,7 +543,7 @@ class SynthEngine
 		}
 	}
 
-	void setOsc2Volume(float value)
+	void applyOsc2Volume(float value)
 	{
 		value = audioUtils.getLogScaledVolume(value, 1.0f);
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -191,7 +553,7 @@ class SynthEngine
 		}
 	}
 
-	void setOsc3Volume(float value)
+	void applyOsc3Volume(float value)
 	{
 		value = audioUtils.getLogScaledVolume(value, 1.0f);
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -273,16 +635,15 @@ class SynthEngine
 
 	void setCutoff(float value)
 	{
-        this->cutoff = audioUtils.getLogScaledValueFilter(value);
+        this->cutoffSmoothed.setTarget(audioUtils.getLogScaledValueFilter(value));
 	}
 
 	void setCutoffFast(float value)
 	{
-		setCutoff(value);
-		cutoffFiltered->currentValue = audioUtils.getLogScaledValueFilter(value);
+		this->cutoffSmoothed.jumpTo(audioUtils.getLogScaledValueFilter(value));
 	}
 
-	void setResonance(float value)
+	void applyResonance(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
@@ -291,7 +652,7 @@ class SynthEngine
 		}
 	}
 
-	void setKeyfollow(float value)
+	void applyKeyfollow(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
@@ -300,7 +661,7 @@ class SynthEngine
 		}
 	}
 
-	void setFilterContour(float value)
+	void applyFilterContour(float value)
 	{
 		value = audioUtils.getLogScaledValueCentered(value);
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -312,19 +673,21 @@ class SynthEngine
 
 	void setFilterAttack(float value)
 	{
+		float rate = Adsr::getAttackRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setFilterAttack(value);
+			voices[i]->setFilterAttack(value, rate);
 		}
 	}
 
 	void setFilterDecay(float value)
 	{
+		float rate = Adsr::getDecayRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setFilterDecay(value);
+			voices[i]->setFilterDecay(value, rate);
 		}
 	}
 
@@ -340,28 +703,31 @@ class SynthEngine
 
 	void setFilterRelease(float value)
 	{
+		float rate = Adsr::getReleaseRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setFilterRelease(value);
+			voices[i]->setFilterRelease(rate);
 		}
 	}
 
 	void setAmpAttack(float value)
 	{
+		float rate = Adsr::getAttackRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setAmpAttack(value);
+			voices[i]->setAmpAttack(value, rate);
 		}
 	}
 
 	void setAmpDecay(float value)
 	{
+		float rate = Adsr::getDecayRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setAmpDecay(value);
+			voices[i]->setAmpDecay(value, rate);
 		}
 	}
 
@@ -376,10 +742,11 @@ class SynthEngine
 
 	void setAmpRelease(float value)
 	{
+		float rate = Adsr::getReleaseRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setAmpRelease(value);
+			voices[i]->setAmpRelease(rate);
 		}
 	}
 
@@ -392,6 +759,26 @@ class SynthEngine
 		}
 	}
 
+	void setGlideMode(float value)
+	{
+		Portamento::GlideMode glideMode = value > 0.0f ? Portamento::CONSTANT_TIME : Portamento::CONSTANT_RATE;
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setGlideMode(glideMode);
+		}
+	}
+
+	void setVelocityCurve(float value)
+	{
+		this->velocityHandler->setVelocityCurve(value);
+	}
+
+	void setKeyfollowCurve(float value)
+	{
+		this->velocityHandler->setKeyfollowCurve(value);
+	}
+
 	void setPortamento(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -401,7 +788,7 @@ class SynthEngine
 		}
 	}
 
-	void setOsc1Pw(float value)
+	void applyOsc1Pw(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
@@ -419,7 +806,7 @@ class SynthEngine
 		}
 	}
 
-	void setOsc1Fm(float value)
+	void applyOsc1Fm(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
@@ -447,35 +834,37 @@ class SynthEngine
 		lfoHandler2->setRate(value, bmp);
 	}
 
-	void setLfo1Amount(float value)
+	void applyLfo1Amount(float value)
 	{
 		lfoHandler1->setAmount(audioUtils.getLogScaledValueCentered(value));
 	}
 
-	void setLfo2Amount(float value)
+	void applyLfo2Amount(float value)
 	{
 		lfoHandler2->setAmount(audioUtils.getLogScaledValueCentered(value));
 	}
 
 	void setFreeAdAttack(float value)
 	{
+		float rate = Adsr::getAttackRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setFreeAdAttack(value);
+			voices[i]->setFreeAdAttack(value, rate);
 		}
 	}
 
 	void setFreeAdDecay(float value)
 	{
+		float rate = Adsr::getDecayRate(value, sampleRate);
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			voices[i]->setFreeAdDecay(value);
+			voices[i]->setFreeAdDecay(value, rate);
 		}
 	}
 
-	void setFreeAdAmount(float value)
+	void applyFreeAdAmount(float value)
 	{
 		value = audioUtils.getLogScaledValueCentered(value);
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -575,12 +964,13 @@ class SynthEngine
         this->pitchwheelHandler->setPitch(value);
 	}
 
-	void setHighPass(float value)
+	void applyHighPass(float value)
 	{
         highPass->setCutoff(audioUtils.getLogScaledValue(value));
+        highPassR->setCutoff(audioUtils.getLogScaledValue(value));
 	}
 
-	void setMastertune(float value)
+	void applyMastertune(float value)
 	{
         value = audioUtils.getLogScaledLinearValueCentered(value);
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -600,7 +990,7 @@ class SynthEngine
 		}
 	}
 
-    void setRingmodulation(float value)
+    void applyRingmodulation(float value)
     {
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
@@ -675,7 +1065,7 @@ class SynthEngine
 		voiceManager->reset();
 	}
 
-	void setDetune(float value)
+	void applyDetune(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
@@ -684,6 +1074,17 @@ class SynthEngine
 		}
 	}
 
+	// -140dB..-60dB, below this a released voice is stopped
+	void setSilenceThreshold(float value)
+	{
+		float threshold = powf(10.0f, (-140.0f + value * 80.0f) / 20.0f);
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setSilenceThreshold(threshold);
+		}
+	}
+
 	void setFiltertype(float value)
 	{
 		SynthVoice** voices = voiceManager->getAllVoices();
@@ -693,16 +1094,60 @@ class SynthEngine
 		}
 	}
 
+	void setFilter2type(float value)
+	{
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setFilter2type(value);
+		}
+	}
+
+	// Offset to the modulated cutoff of filter 1, centered
+	void applyFilter2Cutoff(float value)
+	{
+		value = (value - 0.5f) * 2.0f;
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setFilter2Cutoff(value);
+		}
+	}
+
+	void applyFilter2Resonance(float value)
+	{
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setFilter2Resonance(value);
+		}
+	}
+
+	void setFilterRouting(float value)
+	{
+		FilterHandler::Routing routing = getFilterRouting(value);
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			voices[i]->setFilterRouting(routing);
+		}
+	}
+
     void setChorus(bool isChorus1Enabled, bool isChorus2Enabled)
     {
         this->chorusEngine->setEnablesChorus(isChorus1Enabled, isChorus2Enabled);
     }
 
-    void setReverbWet(float value)
+    void applyReverbWet(float value)
     {
         this->reverbEngine->setWet(value);
     }
 
+    void setReverbMode(float value)
+    {
+        this->reverbEngine->setMode(value);
+    }
+
     void setReverbDecay(float value)
     {
         this->reverbEngine->setDecayTime(value);
@@ -741,68 +1186,244 @@ class SynthEngine
 		}
     }
 
-    void triggerLfoToHost(const float bmp, const float samplePosition)
+    // Position of the first sample of the next host block
+    void setHostPosition(double bpm, double ppqPosition, bool isPlaying)
     {
-        if (lfoHandler1->isSync || lfoHandler2->isSync)
-		{
-			float samplesPerBeat = 60.0f / bmp * sampleRate;
-            
-            if (lfoHandler1->isSync)
-            {
-			    float lfoInc = lfoHandler1->getLfoInc() / 256.0f;
-			    float phase = lfoInc * samplesPerBeat * samplePosition;
-			    lfoHandler1->setHostPhase(phase - floorf(phase));
-            }
-            if (lfoHandler2->isSync)
-            {
-			    float lfoInc = lfoHandler2->getLfoInc() / 256.0f;
-			    float phase = lfoInc * samplesPerBeat * samplePosition;
-			    lfoHandler2->setHostPhase(phase - floorf(phase));
-            }
-		} 
+        if (bpm != transportClock->getBpm())
+        {
+            lfoHandler1->setTempo((float)bpm);
+            lfoHandler2->setTempo((float)bpm);
+        }
+        transportClock->setHostPosition(bpm, ppqPosition, isPlaying);
     }
 
-	void process(float *sampleL, float *sampleR) 
+	void process(float *sampleL, float *sampleR, int numSamples) 
+	{
+		process(sampleL, sampleR, 0, 0, numSamples);
+	}
+
+	// With effectSendL and effectSendR the chorus and reverb are skipped.
+	// The output is the effect input and the reverb sends are written to
+	// effectSendL and effectSendR, for a shared effect bus.
+	void process(float *sampleL, float *sampleR, float *effectSendL, float *effectSendR, int numSamples) 
+	{
+		while (numSamples > 0)
+		{
+			int blockSize = numSamples < controlRate ? numSamples : controlRate;
+			processControlBlock(sampleL, sampleR, effectSendL, effectSendR, blockSize);
+			sampleL += blockSize;
+			sampleR += blockSize;
+			if (effectSendL != 0)
+			{
+				effectSendL += blockSize;
+				effectSendR += blockSize;
+			}
+			numSamples -= blockSize;
+		}
+	}
+
+	// Chorus and reverb in place
+	void processEffects(float *sampleL, float *sampleR, const float *sendL, const float *sendR, int numSamples) 
 	{
-		*sampleL = 0.0f;
-		*sampleR = 0.0f;
+		this->chorusEngine->process(sampleL, sampleR, numSamples);
+		this->reverbEngine->process(sampleL, sampleR, sendL, sendR, numSamples);
+	}
 
-		// Parameter lp filtering
-		float cutoff = cutoffFiltered->tick(this->cutoff);
+private:
+	// Lower mpe zone: channel 1 is the master channel, 2..16 are the member
+	// channels with one note each. Outside of mpe every note is channel 0.
+	int getVoiceChannel(int channel)
+	{
+		if (this->isMpeMode && channel > MPE_MASTER_CHANNEL && channel <= MPE_NUM_CHANNELS)
+		{
+			return channel;
+		}
+		return 0;
+	}
+
+	void resetMpeChannels()
+	{
+		for (int i = 0; i <= MPE_NUM_CHANNELS; i++)
+		{
+			mpePitchbend[i] = 0.0f;
+			mpeSlide[i] = 0.0f;
+			mpePressure[i] = 0.0f;
+		}
+	}
+
+	// Locks the phase of synced lfos to the transport position
+	void syncLfosToTransport()
+	{
+		if (transportClock->getIsPlaying())
+		{
+			if (lfoHandler1->isSync)
+			{
+				float phase = transportClock->getPhase(lfoHandler1->getSyncCyclesPerBeat());
+				lfoHandler1->setHostPhase(phase);
+				lfoBank->setHostPhase(0, phase, lfoHandler1);
+			}
+			if (lfoHandler2->isSync)
+			{
+				float phase = transportClock->getPhase(lfoHandler2->getSyncCyclesPerBeat());
+				lfoHandler2->setHostPhase(phase);
+				lfoBank->setHostPhase(1, phase, lfoHandler2);
+			}
+		}
+	}
+
+	void setSmoothedParameter(SmoothedParameterId id, float value)
+	{
+		smoothedParameters[id].setTarget(value);
+
+		// The first value of a parameter is not ramped
+		if (smoothedParameters[id].isSettled())
+		{
+			applySmoothedParameter(id, value);
+		}
+	}
+
+	// Applies the parameters that are still moving, settled ones cost nothing
+	void processSmoothedParameters(int numSamples)
+	{
+		for (int i = 0; i < NUM_SMOOTHED_PARAMETERS; i++)
+		{
+			if (!smoothedParameters[i].isSettled())
+			{
+				applySmoothedParameter((SmoothedParameterId)i, smoothedParameters[i].advance(numSamples));
+			}
+		}
+	}
+
+	void applySmoothedParameter(SmoothedParameterId id, float value)
+	{
+		switch (id)
+		{
+		case SMOOTHED_OSC1VOLUME: applyOsc1Volume(value); break;
+		case SMOOTHED_OSC2VOLUME: applyOsc2Volume(value); break;
+		case SMOOTHED_OSC3VOLUME: applyOsc3Volume(value); break;
+		case SMOOTHED_RESONANCE: applyResonance(value); break;
+		case SMOOTHED_KEYFOLLOW: applyKeyfollow(value); break;
+		case SMOOTHED_FILTERCONTOUR: applyFilterContour(value); break;
+		case SMOOTHED_OSC1PW: applyOsc1Pw(value); break;
+		case SMOOTHED_OSC1FM: applyOsc1Fm(value); break;
+		case SMOOTHED_RINGMODULATION: applyRingmodulation(value); break;
+		case SMOOTHED_DETUNE: applyDetune(value); break;
+		case SMOOTHED_MASTERTUNE: applyMastertune(value); break;
+		case SMOOTHED_FREEADAMOUNT: applyFreeAdAmount(value); break;
+		case SMOOTHED_LFO1AMOUNT: applyLfo1Amount(value); break;
+		case SMOOTHED_LFO2AMOUNT: applyLfo2Amount(value); break;
+		case SMOOTHED_HIGHPASS: applyHighPass(value); break;
+		case SMOOTHED_FILTER2CUTOFF: applyFilter2Cutoff(value); break;
+		case SMOOTHED_FILTER2RESONANCE: applyFilter2Resonance(value); break;
+		case SMOOTHED_REVERBWET: applyReverbWet(value); break;
+		default: break;
+		}
+	}
+
+	bool isAnyVoicePlaying()
+	{
+		SynthVoice** voices = voiceManager->getAllVoices();
+		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
+		{
+			if (voices[i]->isNotePlaying()) return true;
+		}
+		return false;
+	}
+
+	void processControlBlock(float *sampleL, float *sampleR, float *effectSendL, float *effectSendR, int numSamples) 
+	{
+		memset(sampleL, 0, numSamples * sizeof(float));
+		memset(sampleR, 0, numSamples * sizeof(float));
+		memset(reverbSendL, 0, numSamples * sizeof(float));
+		memset(reverbSendR, 0, numSamples * sizeof(float));
+
+		bool isLfoPerVoice = lfoBank->getIsEnabled();
+		bool isHostPlaying = transportClock->getIsPlaying();
+		this->syncLfosToTransport();
+		this->transportClock->advance(numSamples);
+		if (isAnyVoicePlaying())
+		{
+			float inverseNumSamples = 1.0f / numSamples;
+			if (isLfoPerVoice)
+			{
+				// Volume and pan are applied by the voices
+				lfoBank->process(numSamples, lfoHandler1, lfoHandler2, isHostPlaying);
+				volumeRamp.setTarget(1.0f, inverseNumSamples);
+			}
+			else
+			{
+				// calc next lfo value with modulation of the other LFO
+				lfoHandler1->setRateMultiplier(lfoHandler1->isPhaseLocked(isHostPlaying) ? 0.0f : this->lfoHandler2->getLfo1());
+				lfoHandler1->process(numSamples);
+				lfoHandler2->setRateMultiplier(lfoHandler2->isPhaseLocked(isHostPlaying) ? 0.0f : this->lfoHandler1->getLfo2());
+				lfoHandler2->process(numSamples);
+
+				volumeRamp.setTarget(lfoHandler2->getVolume(), inverseNumSamples);
+				panRamp.setTarget(lfoHandler2->getPan(), inverseNumSamples);
+			}
+		}
+
+		// Parameter smoothing
+		this->processSmoothedParameters(numSamples);
+		if (!cutoffSmoothed.process(cutoffValues, numSamples))
+		{
+			float cutoff = cutoffSmoothed.getValue();
+			for (int i = 0; i < numSamples; i++)
+			{
+				cutoffValues[i] = cutoff;
+			}
+		}
+		bool isVolumeSmoothing = volumeSmoothed.process(volumeValues, numSamples);
+		float volume = volumeSmoothed.getValue();
 
 		// Process voices
 		bool playingNotes = false;
+		SynthVoice** voices = voiceManager->getAllVoices();
 		for (int i = 0; i < voiceManager->MAX_VOICES - 1; i++)
 		{
-			playingNotes |= voiceManager->getAllVoices()[i]->process(sampleL, sampleR, cutoff);
+			playingNotes |= voices[i]->process(sampleL, sampleR, reverbSendL, reverbSendR, cutoffValues, numSamples);
 		}
 
 		if (playingNotes)
 		{
-		    // calc next lfo value with modulation of the other LFO
-            lfoHandler1->setRateMultiplier(this->lfoHandler2->getLfo1());
-		    lfoHandler1->process();
-            lfoHandler2->setRateMultiplier(this->lfoHandler1->getLfo2());
-		    lfoHandler2->process();
-
-            // FIXME: loose stereo information here of a voice
-            highPass->tick(sampleL);
-            *sampleL *= this->lfoHandler2->getVolume();
-            *sampleR = *sampleL;
-
-            // FIXME: rewrite this
-            if (lfoHandler2->getDestination() == LfoHandler2::PAN)
-            {
+			bool isPanEnabled = !isLfoPerVoice && lfoHandler2->getDestination() == LfoHandler2::PAN;
+			if (isPanEnabled)
+			{
                 this->stereoPan->setModulationAmount(lfoHandler2->getAmount());
-                this->stereoPan->process(sampleL, sampleR, lfoHandler2->getPan());
-            }
-
-			*sampleL *= volume;
-			*sampleR *= volume;
+			}
+
+			for (int i = 0; i < numSamples; i++)
+			{
+				highPass->tick(&sampleL[i]);
+				highPassR->tick(&sampleR[i]);
+
+				float lfoVolume = volumeRamp.tick();
+				float pan = panRamp.tick();
+				sampleL[i] *= lfoVolume;
+				sampleR[i] *= lfoVolume;
+
+				if (isPanEnabled)
+				{
+					this->stereoPan->process(&sampleL[i], &sampleR[i], pan);
+				}
+
+				float sampleVolume = isVolumeSmoothing ? volumeValues[i] : volume;
+				sampleL[i] *= sampleVolume;
+				sampleR[i] *= sampleVolume;
+				reverbSendL[i] *= sampleVolume;
+				reverbSendR[i] *= sampleVolume;
+			}
 		}
 
-        this->chorusEngine->process(sampleL, sampleR);
-        this->reverbEngine->process(sampleL, sampleR);
+		if (effectSendL != 0)
+		{
+			memcpy(effectSendL, reverbSendL, numSamples * sizeof(float));
+			memcpy(effectSendR, reverbSendR, numSamples * sizeof(float));
+		}
+		else
+		{
+			processEffects(sampleL, sampleR, reverbSendL, reverbSendR, numSamples);
+		}
 	}
 };
 #endif
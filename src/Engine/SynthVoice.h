@@ -32,18 +32,39 @@
 #include "Portamento.h"
 #include "LfoHandler1.h"
 #include "LfoHandler2.h"
+#include "LfoBank.h"
+#include "StereoPan.h"
 #include "PitchwheelHandler.h"
 #include "VelocityHandler.h"
 #include "AudioUtils.h"
 #include "HighPass.h"
+#include "ModulationRamp.h"
+#include "ModulationMatrix.h"
 
 class SynthVoice
 {
+public:
+	// Midi controllers as per voice modulation sources, [0..1] if not noted
+	enum Expression
+	{
+		EXPRESSION_MODWHEEL = 0,
+		EXPRESSION_AFTERTOUCH,
+		EXPRESSION_CHANNELPRESSURE,
+		EXPRESSION_SLIDE,      // Mpe cc 74
+		EXPRESSION_PITCHBEND,  // Mpe per note pitch bend [-1..1]
+		NUM_EXPRESSIONS
+	};
+
 private:
 	bool isNoteOn;
 
 	float resonance;
+	float filter2Cutoff;
+	float filter2Resonance;
 	float keyfollow;
+
+	// Keyfollow curve value of the note, looked up at note on
+	float keyfollowTracking;
 	float filterContour;
 
     float velocity;
@@ -62,31 +83,90 @@ class SynthVoice
 
 	LfoHandler1 *lfoHandler1;
 	LfoHandler2 *lfoHandler2;
+	LfoBank *lfoBank;
+	int voiceIndex;
     VelocityHandler *velocityHandler;
     PitchwheelHandler *pitchwheelHandler;
+    ModulationMatrix *modulationMatrix;
 
 	int countPostFilter;
 	int countSilentFilter;
 
+	// Modulation, updated once per control block
+	bool isModulationReset;
+	float contourAmount;
+	ModulationRamp cutoffRamp;
+	ModulationRamp glideRamp;
+	ModulationRamp pitchRamp;
+	ModulationRamp osc1PitchRamp;
+	ModulationRamp osc2PitchRamp;
+	ModulationRamp pwRamp;
+	ModulationRamp fmRamp;
+
+	// Lfo 2 pan of the per voice lfos, the global ones pan the whole mix
+	ModulationRamp lfoPanRamp;
+	StereoPan stereoPan;
+	bool isLfoPanEnabled;
+	bool isLfoVolumeEnabled;
+
+	// Destinations only the modulation matrix can reach
+	ModulationRamp resonanceRamp;
+	ModulationRamp panRamp;
+	ModulationRamp volumeRamp;
+	ModulationRamp reverbSendRamp;
+	float modulationSources[ModulationMatrix::NUM_SOURCES];
+
+	// Controller values as received and smoothed at control rate
+	float expressionTarget[NUM_EXPRESSIONS];
+	float expressionValue[NUM_EXPRESSIONS];
+	float expressionSmoothingTime;
+	int expressionSmoothingSamples;
+	float expressionSmoothingFactor;
+
+	// Envelopes of the current control block
+	float filterEnvelope[Adsr::MAX_BLOCK_SIZE];
+	float ampEnvelope[Adsr::MAX_BLOCK_SIZE];
+	float modulationDestinations[ModulationMatrix::NUM_DESTINATIONS];
+
 	int portamentoMode;
-	float portamentoValue;
+
+	// Silence detection in the release phase
+	float silenceThreshold;
+	float ampLevel;
+	int silenceWindowLength;
+	int silenceCount;
+	// Double, the variance is a difference of two close sums with a dc offset
+	double silenceSum;
+	double silenceSumSquares;
 
 	AudioUtils audioUtils;
 
 public:
 	int noteNumber;
 
+	// Mpe member channel of the note, 0 if the note is not per channel
+	int midiChannel;
+
+	// Mpe default per note pitch bend range in semitones
+	static const int MPE_PITCHBEND_RANGE = 48;
+
 	SynthVoice(
         float sampleRate, 
         LfoHandler1 *lfoHandler1, 
         LfoHandler2 *lfoHandler2,
+        LfoBank *lfoBank,
+        int voiceIndex,
         VelocityHandler *velocityHandler, 
-        PitchwheelHandler *pitchwheelHandler)
+        PitchwheelHandler *pitchwheelHandler,
+        ModulationMatrix *modulationMatrix)
 	{
 		this->lfoHandler1 = lfoHandler1;
 		this->lfoHandler2 = lfoHandler2;
+		this->lfoBank = lfoBank;
+		this->voiceIndex = voiceIndex;
         this->velocityHandler = velocityHandler;
         this->pitchwheelHandler = pitchwheelHandler;
+        this->modulationMatrix = modulationMatrix;
 		initialize(sampleRate);
 	}
 
@@ -105,16 +185,33 @@ class SynthVoice
 	{
 		this->isNoteOn = false;
 		this->noteNumber = 60;
+		this->midiChannel = 0;
 		this->resonance = 0.0f;
+		this->filter2Cutoff = 0.0f;
+		this->filter2Resonance = 0.0f;
 		this->keyfollow = 0.0f;
+		this->keyfollowTracking = 0.0f;
 
 		this->filterContour = 0;
 
 		this->countPostFilter = 0;
 		this->countSilentFilter = 0;
 
+		this->isModulationReset = true;
+		this->contourAmount = 0.0f;
+		this->isLfoPanEnabled = false;
+
+		for (int i = 0; i < NUM_EXPRESSIONS; i++)
+		{
+			this->expressionTarget[i] = 0.0f;
+			this->expressionValue[i] = 0.0f;
+		}
+		this->expressionSmoothingTime = sampleRate * 0.005f;
+		this->expressionSmoothingSamples = 0;
+		this->expressionSmoothingFactor = 0.0f;
+		this->isLfoVolumeEnabled = false;
+
 		this->portamentoMode = 0;
-		this->portamentoValue = 0.0f;
 
         this->velocity = 1.0f;
 
@@ -124,11 +221,16 @@ class SynthVoice
         this->detuneFactor = 1.0f;
         this->detune = 0.0f;
 
+		this->silenceThreshold = 0.00001f;
+		this->ampLevel = 0.0f;
+		this->silenceWindowLength = (int)(sampleRate * 0.01f);
+		this->resetSilenceDetection();
+
 		this->freeAdsr = new AdsrHandler((float)sampleRate);
 		this->freeAdsr->setSustain(0.0f);
-		this->freeAdsr->setRelease(1.0f);
+		this->freeAdsr->setRelease(Adsr::getReleaseRate(1.0f, (float)sampleRate));
 
-		this->vco = new Vco(sampleRate, this->lfoHandler1, this->lfoHandler2, this->freeAdsr);
+		this->vco = new Vco(sampleRate);
 		this->filterHandler = new FilterHandler(sampleRate);
 		this->filterAdsr = new Adsr(sampleRate);
 		this->ampAdsr = new Adsr(sampleRate);
@@ -136,30 +238,220 @@ class SynthVoice
 		this->portamento = new Portamento(sampleRate);
 	}
 
-	inline void processFilter(float *sample, float cutoff)
+
+	inline void updateRamp(ModulationRamp *ramp, const float target, const float inverseNumSamples)
+	{
+		if (this->isModulationReset)
+		{
+			ramp->jumpTo(target);
+		}
+		else
+		{
+			ramp->setTarget(target, inverseNumSamples);
+		}
+	}
+
+	// Evaluates all modulation sources and their destinations once per
+	// control block, the audio rate code only ticks the ramps
+	inline void updateModulation(int numSamples)
+	{
+		this->freeAdsr->process(isNoteOn, numSamples);
+		this->processExpression(numSamples);
+
+        float cutoffMod = this->velocityHandler->getCutoff() * this->velocity + this->pitchwheelHandler->getCutoff();
+		cutoffMod += this->keyfollow * this->keyfollowTracking;
+
+		float lfo1 = this->getLfo1Value();
+		float lfo2 = this->getLfo2Value();
+        cutoffMod += this->lfoHandler1->getFilter(lfo1) + this->lfoHandler2->getFilter(lfo2) + this->freeAdsr->getFilter();
+
+		float osc1PitchMod = this->lfoHandler1->getOsc1Pitch(lfo1) + this->lfoHandler2->getOsc1Pitch(lfo2) + this->freeAdsr->getOsc1();
+		float osc2PitchMod = this->lfoHandler1->getOsc2Pitch(lfo1) + this->lfoHandler2->getOsc2Pitch(lfo2) + this->freeAdsr->getOsc2();
+		float pwMod = this->lfoHandler1->getPw(lfo1) + this->freeAdsr->getPw();
+		float fmMod = this->lfoHandler1->getFm(lfo1) + this->freeAdsr->getFm();
+
+        this->contourAmount = filterContour + this->velocityHandler->getContour() * velocity;
+
+		float resonanceMod = this->resonance;
+		float panMod = 0.0f;
+		float volumeMod = 1.0f;
+		float reverbSendMod = 0.0f;
+		if (this->modulationMatrix->hasRoutings())
+		{
+			this->processModulationMatrix();
+			const float *mod = this->modulationDestinations;
+			cutoffMod += mod[ModulationMatrix::DESTINATION_CUTOFF];
+			osc1PitchMod += mod[ModulationMatrix::DESTINATION_PITCH] + mod[ModulationMatrix::DESTINATION_OSC1PITCH];
+			osc2PitchMod += mod[ModulationMatrix::DESTINATION_PITCH] + mod[ModulationMatrix::DESTINATION_OSC2PITCH];
+			pwMod += mod[ModulationMatrix::DESTINATION_PW];
+			fmMod += mod[ModulationMatrix::DESTINATION_FM];
+			resonanceMod = clamp(resonanceMod + mod[ModulationMatrix::DESTINATION_RESONANCE], 0.0f, 1.0f);
+			panMod = clamp(mod[ModulationMatrix::DESTINATION_PAN], -1.0f, 1.0f);
+			volumeMod = clamp(volumeMod + mod[ModulationMatrix::DESTINATION_VOLUME], 0.0f, 2.0f);
+			reverbSendMod = clamp(mod[ModulationMatrix::DESTINATION_REVERBSEND], 0.0f, 1.0f);
+		}
+
+		// With per voice lfos the lfo 2 volume and pan are applied here
+		// instead of on the mix in the engine
+		this->isLfoVolumeEnabled = this->lfoBank->getIsEnabled() && this->lfoHandler2->getDestination() == LfoHandler2::VOLUME;
+		this->isLfoPanEnabled = this->lfoBank->getIsEnabled() && this->lfoHandler2->getDestination() == LfoHandler2::PAN;
+		if (this->isLfoVolumeEnabled)
+		{
+			volumeMod *= this->lfoHandler2->getVolume(lfo2);
+		}
+		if (this->isLfoPanEnabled)
+		{
+			this->stereoPan.setModulationAmount(this->lfoHandler2->getAmount());
+		}
+
+		float inverseNumSamples = 1.0f / numSamples;
+
+		// Starts at the current glide position, also after a new note
+		this->glideRamp.jumpTo(this->portamento->getValue());
+		this->glideRamp.setTarget(this->portamento->process((float)noteNumber, portamentoMode > 0, numSamples), inverseNumSamples);
+
+		updateRamp(&cutoffRamp, cutoffMod, inverseNumSamples);
+		float pitchMod = this->pitchwheelHandler->getPitch() + this->expressionValue[EXPRESSION_PITCHBEND] * MPE_PITCHBEND_RANGE;
+		updateRamp(&pitchRamp, pitchMod, inverseNumSamples);
+		updateRamp(&osc1PitchRamp, osc1PitchMod, inverseNumSamples);
+		updateRamp(&osc2PitchRamp, osc2PitchMod, inverseNumSamples);
+		updateRamp(&pwRamp, pwMod, inverseNumSamples);
+		updateRamp(&fmRamp, fmMod, inverseNumSamples);
+		updateRamp(&lfoPanRamp, this->lfoHandler2->getPan(lfo2), inverseNumSamples);
+		updateRamp(&resonanceRamp, resonanceMod, inverseNumSamples);
+		updateRamp(&panRamp, panMod, inverseNumSamples);
+		updateRamp(&volumeRamp, volumeMod, inverseNumSamples);
+		updateRamp(&reverbSendRamp, reverbSendMod, inverseNumSamples);
+		this->isModulationReset = false;
+	}
+
+	// One pole with a 5ms time constant, advanced by one control block
+	inline void processExpression(int numSamples)
+	{
+		if (this->expressionSmoothingSamples != numSamples)
+		{
+			this->expressionSmoothingSamples = numSamples;
+			this->expressionSmoothingFactor = 1.0f - expf(-numSamples / this->expressionSmoothingTime);
+		}
+
+		for (int i = 0; i < NUM_EXPRESSIONS; i++)
+		{
+			if (this->isModulationReset)
+			{
+				this->expressionValue[i] = this->expressionTarget[i];
+			}
+			else
+			{
+				this->expressionValue[i] += (this->expressionTarget[i] - this->expressionValue[i]) * this->expressionSmoothingFactor;
+			}
+		}
+	}
+
+	inline float getLfo1Value()
+	{
+		return this->lfoBank->getIsEnabled() ? this->lfoBank->getLfo1(this->voiceIndex) : this->lfoHandler1->getValue();
+	}
+
+	inline float getLfo2Value()
+	{
+		return this->lfoBank->getIsEnabled() ? this->lfoBank->getLfo2(this->voiceIndex) : this->lfoHandler2->getValue();
+	}
+
+	inline void triggerLfoPhase()
+	{
+		if (this->lfoBank->getIsEnabled())
+		{
+			this->lfoBank->triggerPhase(this->voiceIndex, this->lfoHandler1, this->lfoHandler2);
+		}
+		else
+		{
+			this->lfoHandler1->triggerPhase();
+			this->lfoHandler2->triggerPhase();
+		}
+	}
+
+	inline float clamp(float value, float min, float max)
+	{
+		if (value < min) return min;
+		if (value > max) return max;
+		return value;
+	}
+
+	// The per voice sources, all of them [-1..1] or [0..1]
+	inline void processModulationMatrix()
+	{
+		float *sources = this->modulationSources;
+		sources[ModulationMatrix::SOURCE_OFF] = 0.0f;
+		sources[ModulationMatrix::SOURCE_LFO1] = this->getLfo1Value();
+		sources[ModulationMatrix::SOURCE_LFO2] = this->getLfo2Value();
+		sources[ModulationMatrix::SOURCE_FREEAD] = this->freeAdsr->value;
+		sources[ModulationMatrix::SOURCE_FILTERENVELOPE] = this->filterAdsr->getValueFasterAttack();
+		sources[ModulationMatrix::SOURCE_AMPENVELOPE] = this->ampLevel;
+		sources[ModulationMatrix::SOURCE_VELOCITY] = this->velocity;
+		sources[ModulationMatrix::SOURCE_KEY] = ((float)this->noteNumber - 60.0f) / 64.0f;
+		sources[ModulationMatrix::SOURCE_PITCHWHEEL] = this->pitchwheelHandler->getPosition();
+		sources[ModulationMatrix::SOURCE_MODWHEEL] = this->expressionValue[EXPRESSION_MODWHEEL];
+		sources[ModulationMatrix::SOURCE_AFTERTOUCH] = this->expressionValue[EXPRESSION_AFTERTOUCH];
+		sources[ModulationMatrix::SOURCE_CHANNELPRESSURE] = this->expressionValue[EXPRESSION_CHANNELPRESSURE];
+		sources[ModulationMatrix::SOURCE_SLIDE] = this->expressionValue[EXPRESSION_SLIDE];
+
+		this->modulationMatrix->process(sources, this->modulationDestinations);
+	}
+
+	// cutoff includes the control rate modulation
+	inline void processFilter(float *sampleL, float *sampleR, float cutoff, float resonance, float contourAdsr)
 	{	
-        cutoff += this->velocityHandler->getCutoff() * this->velocity + this->pitchwheelHandler->getCutoff();
-		cutoff += this->keyfollow * (((float)this->noteNumber - 72.0f) / 512.0f);
-        cutoff += this->lfoHandler1->getFilter() + this->lfoHandler2->getFilter();
+		cutoff += this->contourAmount * contourAdsr;
 
-		float contourAdsr = this->filterAdsr->tick(isNoteOn, false);
-        float contourAmount = filterContour + this->velocityHandler->getContour() * velocity;
-		cutoff += contourAmount * contourAdsr + this->freeAdsr->getFilter();
+		// Filter 2 follows the modulated cutoff with an offset
+		float cutoff2 = cutoff + this->filter2Cutoff;
         cutoff = cutoff * cutoff;
+		cutoff2 = cutoff2 * cutoff2;
 
 		if (cutoff > 1.0f) cutoff = 1.0f;
 		if (cutoff < 0.0f) cutoff = 0.0f;
-        this->filterHandler->process(sample, cutoff, this->resonance);
+		if (cutoff2 > 1.0f) cutoff2 = 1.0f;
+		if (cutoff2 < 0.0f) cutoff2 = 0.0f;
+        this->filterHandler->process(sampleL, sampleR, cutoff, resonance, cutoff2, this->filter2Resonance);
 	}
 
-	inline void processAmp(float *sample)
+	inline void processAmp(float *sampleL, float *sampleR, float ampLevel)
 	{ 
-		*sample *= this->ampAdsr->tick(isNoteOn, false);
+		this->ampLevel = ampLevel;
+		*sampleL *= this->ampLevel;
+		*sampleR *= this->ampLevel;
+	}
+
+	inline void resetSilenceDetection()
+	{
+		this->silenceCount = 0;
+		this->silenceSum = 0.0;
+		this->silenceSumSquares = 0.0;
 	}
 
-	inline void processFreeEnvelope()
+	// Retires a released voice once the amp envelope or the output rms over
+	// a short window drops below the silence threshold. The mean is removed
+	// from the rms, so a voice stuck on a dc offset counts as silent too.
+	// Returns true when the voice was retired
+	inline bool processSilenceDetection(float sample)
 	{
-		this->freeAdsr->process(isNoteOn);
+		this->silenceSum += sample;
+		this->silenceSumSquares += (double)sample * sample;
+
+		if (++this->silenceCount >= this->silenceWindowLength)
+		{
+			double mean = this->silenceSum / this->silenceWindowLength;
+			double power = this->silenceSumSquares / this->silenceWindowLength - mean * mean;
+			double thresholdSquared = (double)this->silenceThreshold * this->silenceThreshold;
+
+			this->resetSilenceDetection();
+			if (this->ampLevel < this->silenceThreshold || power < thresholdSquared)
+			{
+				this->ampAdsr->resetAll();
+				return true;
+			}
+		}
+		return false;
 	}
 
     inline void calcRandomDetuneFactor()
@@ -178,11 +470,11 @@ class SynthVoice
 		if (countPostFilter++ < 2000)
 		{
 		    float silentSample = 0.0f;
+		    float silentSampleR = 0.0f;
 			this->filterAdsr->resetState();
 			this->freeAdsr->resetState();
-			this->lfoHandler1->triggerPhase();
-			this->lfoHandler2->triggerPhase();
-            processFilter(&silentSample, cutoff + 0.1f);
+			this->triggerLfoPhase();
+            processFilter(&silentSample, &silentSampleR, cutoff + 0.1f + this->cutoffRamp.getValue(), this->resonance, this->filterAdsr->tick(isNoteOn, false));
 		}
 	}
 
@@ -199,6 +491,11 @@ class SynthVoice
 
 	void setNoteOn(int note, bool slide, float velocity)
 	{
+		// Poly aftertouch belongs to the note
+		this->expressionTarget[EXPRESSION_AFTERTOUCH] = 0.0f;
+
+		velocity = this->velocityHandler->getVelocity(velocity);
+
 		switch (portamentoMode)
 		{
 		case 1:
@@ -206,8 +503,7 @@ class SynthVoice
 			this->filterAdsr->resetAll();
 			this->portamento->setUpNote((float)note);
 			this->freeAdsr->resetAll();
-			this->lfoHandler1->triggerPhase();
-			this->lfoHandler2->triggerPhase();
+			this->triggerLfoPhase();
             this->velocity = velocity;
 			break;
 		case 2:
@@ -219,8 +515,7 @@ class SynthVoice
 				this->filterAdsr->resetState();
 				this->ampAdsr->resetState();
 				this->freeAdsr->resetState();
-				this->lfoHandler1->triggerPhase();
-				this->lfoHandler2->triggerPhase();
+				this->triggerLfoPhase();
                 this->velocity = velocity;
 			}
 			break;
@@ -233,14 +528,16 @@ class SynthVoice
 			this->ampAdsr->resetAll();
 			this->filterAdsr->resetAll();
 			this->freeAdsr->resetAll();
-			this->lfoHandler1->triggerPhase();
-			this->lfoHandler2->triggerPhase();
+			this->triggerLfoPhase();
             this->velocity = velocity;
+			this->isModulationReset = true;
 		}
 
 		this->isNoteOn = true;
 		this->noteNumber = note;
+		this->keyfollowTracking = this->velocityHandler->getKeyfollow(note);
 		this->countPostFilter = 0;
+		this->resetSilenceDetection();
 
         this->calcRandomDetuneFactor();
 	}
@@ -260,14 +557,14 @@ class SynthVoice
 		this->resonance = value;
 	}
 
-	void setFilterAttack(float value)
+	void setFilterAttack(float value, float rate)
 	{
-		this->filterAdsr->setAttack(value);
+		this->filterAdsr->setAttack(value, rate);
 	}
 
-	void setFilterDecay(float value)
+	void setFilterDecay(float value, float rate)
 	{
-		this->filterAdsr->setDecay(value);
+		this->filterAdsr->setDecay(value, rate);
 	}
 
 	void setFilterSustain(float value)
@@ -275,19 +572,19 @@ class SynthVoice
 		this->filterAdsr->setSustain(value);
 	}
 
-	void setFilterRelease(float value)
+	void setFilterRelease(float rate)
 	{
-		this->filterAdsr->setRelease(value);
+		this->filterAdsr->setRelease(rate);
 	}
 
-	void setAmpAttack(float value)
+	void setAmpAttack(float value, float rate)
 	{
-		this->ampAdsr->setAttack(value);
+		this->ampAdsr->setAttack(value, rate);
 	}
 
-	void setAmpDecay(float value)
+	void setAmpDecay(float value, float rate)
 	{
-		this->ampAdsr->setDecay(value);
+		this->ampAdsr->setDecay(value, rate);
 	}
 
 	void setAmpSustain(float value)
@@ -295,9 +592,9 @@ class SynthVoice
 		this->ampAdsr->setSustain(value);
 	}
 
-	void setAmpRelease(float value)
+	void setAmpRelease(float rate)
 	{
-		this->ampAdsr->setRelease(value);
+		this->ampAdsr->setRelease(rate);
 	}  
 
 	void setKeyfollow(float value)
@@ -367,7 +664,12 @@ class SynthVoice
 
 	void setPortamento(float value)
 	{
-		this->portamentoValue = value;
+		this->portamento->setSpeed(value);
+	}
+
+	void setGlideMode(Portamento::GlideMode glideMode)
+	{
+		this->portamento->setGlideMode(glideMode);
 	}
 
 	void setOsc1Pw(float value)
@@ -390,14 +692,14 @@ class SynthVoice
 		this->vco->setOsc2Phase(value);
 	}
 
-	void setFreeAdAttack(float value)
+	void setFreeAdAttack(float value, float rate)
 	{
-		this->freeAdsr->setAttack(value);
+		this->freeAdsr->setAttack(value, rate);
 	}
 
-	void setFreeAdDecay(float value)
+	void setFreeAdDecay(float value, float rate)
 	{
-		this->freeAdsr->setDecay(value);
+		this->freeAdsr->setDecay(value, rate);
 	}
 
 	void setFreeAdAmount(float value)
@@ -455,6 +757,17 @@ class SynthVoice
         this->detune = value;
 	}
 
+	// value [0..1]
+	void setExpression(Expression expression, float value)
+	{
+		this->expressionTarget[expression] = value;
+	}
+
+	void setSilenceThreshold(float value)
+	{
+		this->silenceThreshold = value;
+	}
+
 	void setMastertune(float value)
 	{
         this->mastertune = value;
@@ -481,28 +794,103 @@ class SynthVoice
         this->countPostFilter = 0;
 	}
 
-	inline bool process(float* sampleL, float* sampleR, float cutoff)
+	void setFilter2type(float value)
+	{
+        this->filterHandler->setFilter2type(value);
+        this->countPostFilter = 0;
+	}
+
+	void setFilter2Cutoff(float value)
+	{
+		this->filter2Cutoff = value;
+	}
+
+	void setFilter2Resonance(float value)
+	{
+		this->filter2Resonance = value;
+	}
+
+	void setFilterRouting(FilterHandler::Routing routing)
+	{
+		this->filterHandler->setRouting(routing);
+	}
+
+	// Renders one control block, cutoff holds the smoothed cutoff per sample.
+	// The send buffers feed the reverb without going to the dry output.
+	inline bool process(float* sampleL, float* sampleR, float* sendL, float* sendR, const float* cutoff, int numSamples)
 	{
-		float sample = 0.0f;
 		if (this->isNotePlaying())
 		{
-			this->processFreeEnvelope();
+			this->updateModulation(numSamples);
 
-			float masterNote = this->portamento->tick((float)noteNumber, portamentoValue, portamentoMode > 0.5f);
-            masterNote += this->pitchwheelHandler->getPitch() + this->mastertune + this->transpose;
-            masterNote *= (this->detuneFactor * this->detune + 1.0f);
-            this->vco->process(&sample, masterNote);
+            float volume = this->velocityHandler->getVolume(velocity);
+			float detuneFactor = this->detuneFactor * this->detune + 1.0f;
 
-			this->processFilter(&sample, cutoff);
-			this->processAmp(&sample);
+			// Matrix only destinations, no per sample cost if unused
+			bool isResonanceModulated = this->modulationMatrix->isUsed(ModulationMatrix::DESTINATION_RESONANCE);
+			bool isPanModulated = this->modulationMatrix->isUsed(ModulationMatrix::DESTINATION_PAN);
+			bool isVolumeModulated = this->modulationMatrix->isUsed(ModulationMatrix::DESTINATION_VOLUME) || this->isLfoVolumeEnabled;
+			bool isReverbSendModulated = this->modulationMatrix->isUsed(ModulationMatrix::DESTINATION_REVERBSEND);
 
-            sample *= this->velocityHandler->getVolume(velocity);
+			this->filterAdsr->process(isNoteOn, false, filterEnvelope, numSamples);
+			this->ampAdsr->process(isNoteOn, false, ampEnvelope, numSamples);
 
-			*sampleL += sample;
-			*sampleR += sample;
+			for (int i = 0; i < numSamples; i++)
+			{
+				float voiceSampleL = 0.0f;
+				float voiceSampleR = 0.0f;
+
+				float masterNote = this->glideRamp.tick();
+				masterNote += this->pitchRamp.tick() + this->mastertune + this->transpose;
+				masterNote *= detuneFactor;
+				this->vco->process(&voiceSampleL, masterNote, osc1PitchRamp.tick(), osc2PitchRamp.tick(), pwRamp.tick(), fmRamp.tick());
+
+				float resonance = isResonanceModulated ? resonanceRamp.tick() : this->resonance;
+				this->processFilter(&voiceSampleL, &voiceSampleR, cutoff[i] + cutoffRamp.tick(), resonance, filterEnvelope[i]);
+				this->processAmp(&voiceSampleL, &voiceSampleR, ampEnvelope[i]);
+
+				float sampleVolume = isVolumeModulated ? volume * volumeRamp.tick() : volume;
+				voiceSampleL *= sampleVolume;
+				voiceSampleR *= sampleVolume;
+
+				if (isPanModulated)
+				{
+					float pan = panRamp.tick();
+					voiceSampleL *= pan > 0.0f ? 1.0f - pan : 1.0f;
+					voiceSampleR *= pan < 0.0f ? 1.0f + pan : 1.0f;
+				}
+
+				if (this->isLfoPanEnabled)
+				{
+					this->stereoPan.process(&voiceSampleL, &voiceSampleR, lfoPanRamp.tick());
+				}
+
+				if (!this->isNoteOn && this->processSilenceDetection(0.5f * (voiceSampleL + voiceSampleR)))
+				{
+					// The amp envelope was reset, silent from here on
+					for (int j = i + 1; j < numSamples; j++)
+					{
+						ampEnvelope[j] = 0.0f;
+					}
+				}
+
+				if (isReverbSendModulated)
+				{
+					float send = reverbSendRamp.tick();
+					sendL[i] += voiceSampleL * send;
+					sendR[i] += voiceSampleR * send;
+				}
+
+				sampleL[i] += voiceSampleL;
+				sampleR[i] += voiceSampleR;
+			}
 			return true;
 		}
-		this->prepareFilterForNextNote(cutoff);
+
+		for (int i = 0; i < numSamples && countPostFilter < 2000; i++)
+		{
+			this->prepareFilterForNextNote(cutoff[i]);
+		}
 		return false;
 	}
 };
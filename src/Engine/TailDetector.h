@@ -0,0 +1,77 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__TailDetector_h)
+#define __TailDetector_h
+
+#include "Math.h"
+
+// Tells an effect when its input and output have been below -120dB for
+// longer than its buffers are. From then on the effect can be skipped
+// until the input gets loud again.
+class TailDetector 
+{
+private:
+	float threshold;
+	int holdSamples;
+	int silentSamples;
+
+public:
+	TailDetector(int holdSamples) 
+	{
+		this->threshold = 0.000001f;
+		this->holdSamples = holdSamples;
+		this->silentSamples = 0;
+	}
+
+	void setHoldSamples(int holdSamples)
+	{
+		this->holdSamples = holdSamples;
+		this->silentSamples = 0;
+	}
+
+	// Call before processing, true if the effect can be skipped
+	inline bool isSilent(float inputL, float inputR)
+	{
+		if (fabsf(inputL) > threshold || fabsf(inputR) > threshold)
+		{
+			silentSamples = 0;
+			return false;
+		}
+		return silentSamples >= holdSamples;
+	}
+
+	// Call with the effect output after processing
+	inline void tick(float outputL, float outputR)
+	{
+		if (fabsf(outputL) > threshold || fabsf(outputR) > threshold)
+		{
+			silentSamples = 0;
+		}
+		else
+		{
+			silentSamples++;
+		}
+	}
+};
+#endif
@@ -0,0 +1,142 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__TrackingCurve_h)
+#define __TrackingCurve_h
+
+#include "Math.h"
+
+// Maps a midi value (note number or velocity) to a tracking amount through
+// a selectable curve. The table is rebuilt when the curve changes, so a
+// note on costs a single lookup.
+class TrackingCurve 
+{
+public:
+	enum Curve
+	{
+		LINEAR = 0,
+		EXPONENTIAL,
+		LOGARITHMIC,
+		NUM_CURVES
+	};
+
+	static const int TABLE_SIZE = 128;
+
+private:
+	float table[TABLE_SIZE];
+
+	float minValue;
+	float maxValue;
+	int pivot;
+
+	Curve curve;
+
+public:
+	// The linear curve runs from minValue at midi value 0 to maxValue at 127.
+	// The other curves bend each side of the pivot separately, so the pivot
+	// keeps its linear value whatever the curve.
+	TrackingCurve(float minValue, float maxValue, int pivot) 
+	{
+		this->minValue = minValue;
+		this->maxValue = maxValue;
+		this->pivot = pivot;
+		this->curve = LINEAR;
+		updateTable();
+	}
+
+	// value [0..1]
+	void setCurve(float value)
+	{
+		int curveInt = (int)(value * (NUM_CURVES - 1.0f) + 0.000001f);
+		switch (curveInt)
+		{
+		case LINEAR: this->setCurve(LINEAR); break;
+		case EXPONENTIAL: this->setCurve(EXPONENTIAL); break;
+		case LOGARITHMIC: this->setCurve(LOGARITHMIC); break;
+		}
+	}
+
+	void setCurve(Curve curve)
+	{
+		this->curve = curve;
+		updateTable();
+	}
+
+	// midiValue [0..127]
+	inline float getValue(int midiValue) const
+	{
+		if (midiValue < 0) midiValue = 0;
+		if (midiValue >= TABLE_SIZE) midiValue = TABLE_SIZE - 1;
+		return this->table[midiValue];
+	}
+
+	// value [0..1], rounded to the nearest midi value
+	inline float getValue(float value) const
+	{
+		return getValue((int)(value * (TABLE_SIZE - 1) + 0.5f));
+	}
+
+private:
+	void updateTable()
+	{
+		float pivotValue = getLinearValue(this->pivot);
+		for (int i = 0; i < TABLE_SIZE; i++)
+		{
+			if (this->curve == LINEAR)
+			{
+				this->table[i] = getLinearValue(i);
+			}
+			else if (i >= this->pivot)
+			{
+				float x = (float)(i - this->pivot) / (TABLE_SIZE - 1 - this->pivot);
+				this->table[i] = pivotValue + (this->maxValue - pivotValue) * getShape(x);
+			}
+			else
+			{
+				float x = (float)(this->pivot - i) / this->pivot;
+				this->table[i] = pivotValue - (pivotValue - this->minValue) * getShape(x);
+			}
+		}
+	}
+
+	float getLinearValue(int midiValue) const
+	{
+		float x = (float)midiValue / (TABLE_SIZE - 1);
+		return this->minValue + (this->maxValue - this->minValue) * x;
+	}
+
+	// Normalized curve shape, x and result [0..1]
+	float getShape(float x) const
+	{
+		switch (this->curve)
+		{
+		case EXPONENTIAL:
+			return (powf(16.0f, x) - 1.0f) / 15.0f;
+		case LOGARITHMIC:
+			return 1.0f - (powf(16.0f, 1.0f - x) - 1.0f) / 15.0f;
+		default:
+			return x;
+		}
+	}
+};
+#endif
@@ -0,0 +1,106 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__TransportClock_h)
+#define __TransportClock_h
+
+#include "Math.h"
+
+// Follows the host transport in double precision. Between host updates
+// the position is advanced by the rendered samples at the current tempo,
+// host positions that agree with that prediction are ignored so the
+// synced lfos run without per block phase corrections. Positions that
+// do not agree (loops, relocation) are taken over as a jump.
+class TransportClock 
+{
+private:
+	double sampleRate;
+	double bpm;
+	double ppqPosition;
+	double beatsPerSample;
+	bool isPlaying;
+	bool isJump;
+
+public:
+	TransportClock(float sampleRate) 
+	{
+		this->sampleRate = sampleRate;
+		this->bpm = 120.0;
+		this->ppqPosition = 0.0;
+		this->beatsPerSample = bpm / (60.0 * sampleRate);
+		this->isPlaying = false;
+		this->isJump = false;
+	}
+
+	// Called once per host block with the position of its first sample
+	void setHostPosition(double bpm, double ppqPosition, bool isPlaying)
+	{
+		if (bpm <= 0.0) bpm = 120.0;
+
+		// Allow the rounding of a few samples before treating it as jump
+		double tolerance = 4.0 * this->beatsPerSample;
+		this->isJump = !this->isPlaying || fabs(ppqPosition - this->ppqPosition) > tolerance;
+		if (this->isJump)
+		{
+			this->ppqPosition = ppqPosition;
+		}
+
+		this->bpm = bpm;
+		this->beatsPerSample = bpm / (60.0 * this->sampleRate);
+		this->isPlaying = isPlaying;
+	}
+
+	void advance(int numSamples)
+	{
+		this->ppqPosition += numSamples * this->beatsPerSample;
+	}
+
+	bool getIsPlaying()
+	{
+		return this->isPlaying;
+	}
+
+	// True if the last host position was a jump, cleared by the next update
+	bool getIsJump()
+	{
+		return this->isJump;
+	}
+
+	double getBpm()
+	{
+		return this->bpm;
+	}
+
+	double getPpqPosition()
+	{
+		return this->ppqPosition;
+	}
+
+	// Phase [0..1] of a synced lfo at the current position
+	float getPhase(double cyclesPerBeat)
+	{
+		double phase = this->ppqPosition * cyclesPerBeat;
+		return (float)(phase - floor(phase));
+	}
+};
+#endif
@@ -25,9 +25,6 @@
 #define Vco_H
 
 #include "Osc.h"
-#include "LfoHandler1.h"
-#include "LfoHandler2.h"
-#include "AdsrHandler.h"
 #include "AudioUtils.h"
 
 class Vco
@@ -37,10 +34,6 @@ class Vco
 	Osc *osc2;
 	Osc *osc3;
 
-	LfoHandler1 *lfoHandler1;
-	LfoHandler2 *lfoHandler2;
-	AdsrHandler *freeAdsrHandler;
-
 	float oldNoteValue;
 	float currentFrequency;
 
@@ -60,12 +53,8 @@ class Vco
 	AudioUtils audioUtils;
 
 public:
-	Vco(float sampleRate, LfoHandler1 *lfoHandler1, LfoHandler2 *lfoHandler2, AdsrHandler *freeAdsrHandler)
+	Vco(float sampleRate)
 	{
-		this->lfoHandler1 = lfoHandler1;
-		this->lfoHandler2 = lfoHandler2;
-		this->freeAdsrHandler = freeAdsrHandler;
-
 		oldNoteValue = 0.0f;
 		currentFrequency = 440.0f;
 
@@ -188,20 +177,18 @@ class Vco
         this->oscBitcrusher = audioUtils.getBitDepthDynamic(value);
     }
 
-	void process(float *sample, float note)
+	// The modulation values come from the voice, already summed up over all sources
+	void process(float *sample, float note, float osc1PitchMod, float osc2PitchMod, float pwMod, float fmMod)
 	{
 		float masterNote = note - 24.0f;
-		float osc1Note = note + osc1FineTune + osc1Tune;
-		osc1Note += lfoHandler1->getOsc1Pitch() + lfoHandler2->getOsc1Pitch() + freeAdsrHandler->getOsc1();
-		
-		float osc2Note = note + osc2FineTune + osc2Tune;
-		osc2Note += lfoHandler1->getOsc2Pitch() + lfoHandler2->getOsc2Pitch() + freeAdsrHandler->getOsc2();
+		float osc1Note = note + osc1FineTune + osc1Tune + osc1PitchMod;
+		float osc2Note = note + osc2FineTune + osc2Tune + osc2PitchMod;
 
-		float osc1PwSum = lfoHandler1->getPw() + this->osc1Pw + this->freeAdsrHandler->getPw();
+		float osc1PwSum = this->osc1Pw + pwMod;
 		if (osc1PwSum > 1.0f) osc1PwSum = 1.0f;
 
 		osc1->setPw(osc1PwSum);
-		osc2->setFm(lfoHandler1->getFm() + this->osc2Fm + this->freeAdsrHandler->getFm());
+		osc2->setFm(this->osc2Fm + fmMod);
 		osc2->setFmFrequency(osc1->getCurrentFrequency());
 
 		*sample += this->osc3->process(masterNote);
@@ -25,6 +25,7 @@
 #define VelocityHandler_H
 
 #include "AudioUtils.h"
+#include "TrackingCurve.h"
 
 class VelocityHandler
 {
@@ -35,8 +36,16 @@ class VelocityHandler
 
     AudioUtils audioUtils;
 
+    TrackingCurve velocityCurve;
+
+    // Linear curve is the classic (note - 72) / 512 keyfollow, note 72
+    // stays at 0 with every curve
+    TrackingCurve keyfollowCurve;
+
 public:
     VelocityHandler(float sampleRate) 
+        : velocityCurve(0.0f, 1.0f, 0),
+          keyfollowCurve(-72.0f / 512.0f, 55.0f / 512.0f, 72)
     {
         this->volume = 0.0f;
         this->contour = 0.0f;
@@ -62,6 +71,28 @@ class VelocityHandler
         this->cutoff = audioUtils.getLogScaledValueFilter(value);
     }
 
+    void setVelocityCurve(float value)
+    {
+        this->velocityCurve.setCurve(value);
+    }
+
+    void setKeyfollowCurve(float value)
+    {
+        this->keyfollowCurve.setCurve(value);
+    }
+
+    // Called once per note on, velocity [0..1]
+    inline float getVelocity(float velocity)
+    {
+        return this->velocityCurve.getValue(velocity);
+    }
+
+    // Called once per note on, scaled by the keyfollow amount
+    inline float getKeyfollow(int note)
+    {
+        return this->keyfollowCurve.getValue(note);
+    }
+
     inline float getVolume(float velocity)
     {
         return 1.0f - (this->volume * (1.0f - velocity));
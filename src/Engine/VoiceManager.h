@@ -43,14 +43,16 @@ class VoiceManager
         float sampleRate, 
         LfoHandler1 *lfoHandler1, 
         LfoHandler2 *lfoHandler2, 
+        LfoBank *lfoBank,
         VelocityHandler *velocityHandler, 
-        PitchwheelHandler *pitchwheelHandler)
+        PitchwheelHandler *pitchwheelHandler,
+        ModulationMatrix *modulationMatrix)
 	{
 		// Initialize voices
 		voices = new SynthVoice*[MAX_VOICES];
 		for (int i = 0; i < MAX_VOICES; i++)
 		{
-			voices[i] = new SynthVoice(sampleRate, lfoHandler1, lfoHandler2, velocityHandler, pitchwheelHandler);
+			voices[i] = new SynthVoice(sampleRate, lfoHandler1, lfoHandler2, lfoBank, i, velocityHandler, pitchwheelHandler, modulationMatrix);
 		}
 
 		numberOfVoices = 6;
@@ -61,7 +63,11 @@ class VoiceManager
 
 	~VoiceManager() 
 	{
-		delete voices;
+		for (int i = 0; i < MAX_VOICES; i++)
+		{
+			delete voices[i];
+		}
+		delete[] voices;
 	}
 
 	void reset()
@@ -85,21 +91,26 @@ class VoiceManager
 		playingNotes.clear();
 	}
 
-	void setNoteOn(int note, float velocity)
+	// channel: mpe member channel or 0, returns the voice playing the note
+	SynthVoice* setNoteOn(int note, float velocity, int channel)
 	{
 		if (numberOfVoices > 1)
 		{
 			deleteSilentVoices();
 
 			// Get next voice / if possible next free or the same note
-			SynthVoice* synthvoice = getNewVoice(note);
+			SynthVoice* synthvoice = getNewVoice(note, channel);
+			synthvoice->midiChannel = channel;
 			synthvoice->setNoteOn(note, false, velocity);
+			return synthvoice;
 		}
 		else
 		{
 			// Mono
 			monoNoteStack.insert(monoNoteStack.begin(), note);
+			voices[0]->midiChannel = channel;
 			voices[0]->setNoteOn(note, false, velocity);
+			return voices[0];
 		}
 	}
 
@@ -120,11 +131,11 @@ class VoiceManager
 		}
 	}
 
-	void setNoteOff(int note)
+	void setNoteOff(int note, int channel)
 	{
 		if (numberOfVoices > 1)
 		{
-			setNoteOffPoly(note);
+			setNoteOffPoly(note, channel);
 		}
 		else
 		{
@@ -161,13 +172,13 @@ class VoiceManager
 		}
 	}
 
-	void setNoteOffPoly(int note)
+	void setNoteOffPoly(int note, int channel)
 	{
 		vector<SynthVoice*>::iterator it= playingNotes.begin();
 		while (it != playingNotes.end()) 
 		{	
 			SynthVoice* synthVoice = *it;
-			if (synthVoice->noteNumber == note) 
+			if (synthVoice->noteNumber == note && synthVoice->midiChannel == channel) 
 			{
 				synthVoice->setNoteOff(note);
 				break;
@@ -176,6 +187,31 @@ class VoiceManager
 		}
 	}
 
+	// Polyphonic aftertouch goes to the voices playing the note on the
+	// channel, matched like the note off
+	void setAftertouch(int note, int channel, float value)
+	{
+ 		for (int i = 0; i < this->MAX_VOICES - 1; i++)
+		{
+			if (voices[i]->noteNumber == note && voices[i]->midiChannel == channel && voices[i]->isNotePlaying())
+			{
+				voices[i]->setExpression(SynthVoice::EXPRESSION_AFTERTOUCH, value);
+			}
+		}
+	}
+
+	// Per channel controllers of mpe go to the voices of that member channel
+	void setChannelExpression(int channel, SynthVoice::Expression expression, float value)
+	{
+ 		for (int i = 0; i < this->MAX_VOICES - 1; i++)
+		{
+			if (voices[i]->midiChannel == channel)
+			{
+				voices[i]->setExpression(expression, value);
+			}
+		}
+	}
+
 	vector<SynthVoice*> getVoicesToPlay()
 	{
 		return playingNotes;
@@ -187,14 +223,14 @@ class VoiceManager
 	}
 
 private:
-	SynthVoice* getNewVoice(int note)
+	SynthVoice* getNewVoice(int note, int channel)
 	{
 		// Try to return same note
 		vector<SynthVoice*>::iterator it= playingNotes.begin();
 		while (it != playingNotes.end()) 
 		{	
 			SynthVoice* synthVoice = *it;
-			if (synthVoice->noteNumber == note) 
+			if (synthVoice->noteNumber == note && synthVoice->midiChannel == channel) 
 			{
 				return synthVoice;
 			}
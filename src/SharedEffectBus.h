@@ -0,0 +1,334 @@
+/*
+	==============================================================================
+	This file is part of Tal-NoiseMaker by Patrick Kunz.
+
+	Copyright(c) 2005-2010 Patrick Kunz, TAL
+	Togu Audio Line, Inc.
+	http://kunz.corrupt.ch
+
+	This file may be licensed under the terms of of the
+	GNU General Public License Version 2 (the ``GPL'').
+
+	Software distributed under the License is distributed
+	on an ``AS IS'' basis, WITHOUT WARRANTY OF ANY KIND, either
+	express or implied. See the GPL for the specific language
+	governing rights and limitations.
+
+	You should have received a copy of the GPL along with this
+	program. If not, go to http://www.gnu.org/licenses/gpl.html
+	or write to the Free Software Foundation, Inc.,  
+	51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+	==============================================================================
+ */
+
+#if !defined(__SharedEffectBus_h)
+#define __SharedEffectBus_h
+
+#include "includes.h"
+
+// Lets all plugin instances in a process share one chorus and reverb.
+// Every registered instance adds its effect input and reverb send to the bus,
+// the first registered instance (the owner) takes the sum and renders it with
+// its own effect engines and settings.
+//
+// Each instance writes into its own ring that only the owner reads, so the
+// audio threads never lock and hosts may render the instances in parallel.
+// Input the owner has not taken yet is heard in its next block, at most two
+// blocks are kept per instance and anything older is dropped as stale, like
+// the input that piles up while the owner is bypassed.
+class SharedEffectBus
+{
+public:
+	// Effect input left and right followed by the reverb send left and right
+	static const int NUM_CHANNELS = 4;
+	static const int MAX_INSTANCES = 64;
+
+	// The instance that becomes the owner is told right away, off the audio
+	// thread, so it can allocate its effect buffers
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+		virtual void sharedEffectOwnerChanged() = 0;
+	};
+
+private:
+	// Effect input of one instance. Positions are in [0..capacity), one
+	// sample stays free to tell a full ring from an empty one.
+	struct Slot
+	{
+		Listener *instance;
+		float *buffers[NUM_CHANNELS];
+		int capacity;
+		int samplesPerBlock;
+		Atomic<int> isActive;
+		Atomic<int> readPosition;
+		Atomic<int> writePosition;
+
+		// Set by the instance when the ring is full, the owner discards
+		// everything before it
+		Atomic<int> flushPosition;
+	};
+
+	// Only taken to register and unregister, never on the audio path
+	CriticalSection lock;
+
+	// In the order of registration, the first one owns the bus
+	Array<Listener*> instances;
+	Atomic<Listener*> owner;
+
+	Slot slots[MAX_INSTANCES];
+
+	// Owners inside takeInput, slot buffers are only freed when there are none
+	Atomic<int> numReaders;
+
+	SharedEffectBus()
+	{
+		for (int i = 0; i < MAX_INSTANCES; i++)
+		{
+			slots[i].instance = 0;
+			slots[i].capacity = 0;
+			slots[i].samplesPerBlock = 0;
+			for (int channel = 0; channel < NUM_CHANNELS; channel++)
+			{
+				slots[i].buffers[channel] = 0;
+			}
+		}
+	}
+
+	~SharedEffectBus()
+	{
+		for (int i = 0; i < MAX_INSTANCES; i++)
+		{
+			for (int channel = 0; channel < NUM_CHANNELS; channel++)
+			{
+				delete[] slots[i].buffers[channel];
+			}
+		}
+	}
+
+public:
+	static SharedEffectBus &getInstance()
+	{
+		static SharedEffectBus instance;
+		return instance;
+	}
+
+	// Not on the audio thread. Returns the slot for addInput, -1 if there is
+	// none left. Registering again grows the slot for longer blocks.
+	int registerInstance(Listener *instance, int samplesPerBlock)
+	{
+		Listener *newOwner = 0;
+		int slot;
+		{
+			const ScopedLock sl(lock);
+			slot = findSlot(instance);
+			if (slot < 0)
+			{
+				slot = findSlot(0);
+				if (slot < 0)
+				{
+					return -1;
+				}
+				slots[slot].instance = instance;
+				instances.add(instance);
+			}
+			if (slots[slot].capacity < getCapacity(samplesPerBlock))
+			{
+				freeSlot(slots[slot]);
+				allocateSlot(slots[slot], samplesPerBlock);
+			}
+			newOwner = updateOwner();
+		}
+		if (newOwner != 0)
+		{
+			newOwner->sharedEffectOwnerChanged();
+		}
+		return slot;
+	}
+
+	// Not on the audio thread. The next registered instance takes over as owner
+	void unregisterInstance(Listener *instance)
+	{
+		Listener *newOwner = 0;
+		{
+			const ScopedLock sl(lock);
+			int slot = findSlot(instance);
+			if (slot < 0)
+			{
+				return;
+			}
+			instances.removeFirstMatchingValue(instance);
+			newOwner = updateOwner();
+			freeSlot(slots[slot]);
+			slots[slot].instance = 0;
+		}
+		if (newOwner != 0)
+		{
+			newOwner->sharedEffectOwnerChanged();
+		}
+	}
+
+	inline bool isOwner(const Listener *instance)
+	{
+		return owner.get() == instance;
+	}
+
+	// Called by every instance once per block after rendering, numSamples at
+	// most the samplesPerBlock it registered with
+	void addInput(int slotIndex, const float *inputL, const float *inputR, const float *sendL, const float *sendR, int numSamples)
+	{
+		const float *input[NUM_CHANNELS] = { inputL, inputR, sendL, sendR };
+
+		Slot &slot = slots[slotIndex];
+		int capacity = slot.capacity;
+		int writePosition = slot.writePosition.get();
+		int available = writePosition - slot.readPosition.get();
+		if (available < 0) available += capacity;
+
+		if (capacity - 1 - available < numSamples)
+		{
+			// The owner has not taken anything for a while, what is in the
+			// ring is stale by now
+			slot.flushPosition.set(writePosition);
+			return;
+		}
+
+		int firstPart = capacity - writePosition < numSamples ? capacity - writePosition : numSamples;
+		for (int channel = 0; channel < NUM_CHANNELS; channel++)
+		{
+			float *buffer = slot.buffers[channel];
+			memcpy(buffer + writePosition, input[channel], firstPart * sizeof(float));
+			memcpy(buffer, input[channel] + firstPart, (numSamples - firstPart) * sizeof(float));
+		}
+
+		writePosition += numSamples;
+		if (writePosition >= capacity) writePosition -= capacity;
+		slot.writePosition.set(writePosition);
+	}
+
+	// Called by the owner once per block, sums numSamples of the input of
+	// every instance, silence where an instance has not added enough
+	void takeInput(float *inputL, float *inputR, float *sendL, float *sendR, int numSamples)
+	{
+		float *output[NUM_CHANNELS] = { inputL, inputR, sendL, sendR };
+		for (int channel = 0; channel < NUM_CHANNELS; channel++)
+		{
+			memset(output[channel], 0, numSamples * sizeof(float));
+		}
+
+		++numReaders;
+		for (int i = 0; i < MAX_INSTANCES; i++)
+		{
+			Slot &slot = slots[i];
+			if (slot.isActive.get() == 0)
+			{
+				continue;
+			}
+
+			int capacity = slot.capacity;
+			int readPosition = slot.readPosition.get();
+			int flushPosition = slot.flushPosition.exchange(-1);
+			if (flushPosition >= 0)
+			{
+				readPosition = flushPosition;
+			}
+
+			int available = slot.writePosition.get() - readPosition;
+			if (available < 0) available += capacity;
+
+			// Keep the latency at one block of the instance at most
+			int maxAvailable = numSamples + slot.samplesPerBlock;
+			if (available > maxAvailable)
+			{
+				readPosition += available - maxAvailable;
+				if (readPosition >= capacity) readPosition -= capacity;
+				available = maxAvailable;
+			}
+
+			int numSamplesTaken = numSamples < available ? numSamples : available;
+			int firstPart = capacity - readPosition < numSamplesTaken ? capacity - readPosition : numSamplesTaken;
+			for (int channel = 0; channel < NUM_CHANNELS; channel++)
+			{
+				const float *buffer = slot.buffers[channel];
+				float *sum = output[channel];
+				for (int j = 0; j < firstPart; j++)
+				{
+					sum[j] += buffer[readPosition + j];
+				}
+				for (int j = firstPart; j < numSamplesTaken; j++)
+				{
+					sum[j] += buffer[j - firstPart];
+				}
+			}
+
+			readPosition += numSamplesTaken;
+			if (readPosition >= capacity) readPosition -= capacity;
+			slot.readPosition.set(readPosition);
+		}
+		--numReaders;
+	}
+
+private:
+	// Room for the block being written plus two blocks of latency
+	static int getCapacity(int samplesPerBlock)
+	{
+		return 3 * samplesPerBlock + 1;
+	}
+
+	int findSlot(const Listener *instance)
+	{
+		for (int i = 0; i < MAX_INSTANCES; i++)
+		{
+			if (slots[i].instance == instance)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// Returns the new owner if it changed
+	Listener *updateOwner()
+	{
+		Listener *first = instances.size() > 0 ? instances.getFirst() : 0;
+		if (owner.get() != first)
+		{
+			owner.set(first);
+			return first;
+		}
+		return 0;
+	}
+
+	void allocateSlot(Slot &slot, int samplesPerBlock)
+	{
+		slot.capacity = getCapacity(samplesPerBlock);
+		slot.samplesPerBlock = samplesPerBlock;
+		for (int channel = 0; channel < NUM_CHANNELS; channel++)
+		{
+			slot.buffers[channel] = new float[slot.capacity];
+		}
+		slot.readPosition.set(0);
+		slot.writePosition.set(0);
+		slot.flushPosition.set(-1);
+		slot.isActive.set(1);
+	}
+
+	// Waits until no owner can be reading the slot before it is freed
+	void freeSlot(Slot &slot)
+	{
+		slot.isActive.set(0);
+		while (numReaders.get() > 0)
+		{
+			Thread::yield();
+		}
+		for (int channel = 0; channel < NUM_CHANNELS; channel++)
+		{
+			delete[] slot.buffers[channel];
+			slot.buffers[channel] = 0;
+		}
+		slot.capacity = 0;
+		slot.samplesPerBlock = 0;
+	}
+};
+#endif
@@ -22,6 +22,9 @@ TalComponent::TalComponent (TalCore* const ownerFilter)
 	keyfollowKnob = addNormalKnob(313, 288, ownerFilter, knobImage, numberOfImages, KEYFOLLOW);
 	filterContourKnob = addNormalKnob(363, 288, ownerFilter, knobImage, numberOfImages, FILTERCONTOUR);
 
+	filter2CutoffKnob = addNormalKnob(188, 329, ownerFilter, knobImage, numberOfImages, FILTER2CUTOFF);
+	filter2ResonanceKnob = addNormalKnob(238, 329, ownerFilter, knobImage, numberOfImages, FILTER2RESONANCE);
+
 	osc1VolumeKnob = addNormalKnob(438, 51, ownerFilter, knobImage, numberOfImages, OSC1VOLUME);
 	osc2VolumeKnob = addNormalKnob(488, 51, ownerFilter, knobImage, numberOfImages, OSC2VOLUME);
 	osc3VolumeKnob = addNormalKnob(538, 51, ownerFilter, knobImage, numberOfImages, OSC3VOLUME);
@@ -93,8 +96,37 @@ TalComponent::TalComponent (TalCore* const ownerFilter)
 	filtertypeComboBox->addItem(T("HP 12dB"),5);
 	filtertypeComboBox->addItem(T("BP 12dB"),6);
 	filtertypeComboBox->addItem(T("Notch"),7);
+	filtertypeComboBox->addItem(T("LP 24dB ZDF"),8);
+	filtertypeComboBox->addItem(T("LP 12dB SVF"),9);
+	filtertypeComboBox->addItem(T("HP 12dB SVF"),10);
+	filtertypeComboBox->addItem(T("BP 12dB SVF"),11);
+	filtertypeComboBox->addItem(T("Notch SVF"),12);
     filtertypeComboBox->setColour(ComboBox::backgroundColourId, Colour((juce::uint8)8, (juce::uint8)11, (juce::uint8)58, 0.0f));
 
+	// Filter 2 type 0 is off, the item ids are the type ids + 1
+	filter2typeComboBox = addComboBox(292, 335, 80, ownerFilter, FILTER2TYPE);
+	filter2typeComboBox->addItem(T("Off"),1);
+	filter2typeComboBox->addItem(T("LP 24dB"),2);
+	filter2typeComboBox->addItem(T("LP 18dB"),3);
+	filter2typeComboBox->addItem(T("LP 12dB"),4);
+	filter2typeComboBox->addItem(T("LP 6dB"),5);
+	filter2typeComboBox->addItem(T("HP 12dB"),6);
+	filter2typeComboBox->addItem(T("BP 12dB"),7);
+	filter2typeComboBox->addItem(T("Notch"),8);
+	filter2typeComboBox->addItem(T("LP 24dB ZDF"),9);
+	filter2typeComboBox->addItem(T("LP 12dB SVF"),10);
+	filter2typeComboBox->addItem(T("HP 12dB SVF"),11);
+	filter2typeComboBox->addItem(T("BP 12dB SVF"),12);
+	filter2typeComboBox->addItem(T("Notch SVF"),13);
+	filter2typeComboBox->setSelectedId((int)ownerFilter->getParameter(FILTER2TYPE) + 1, true);
+
+	// The routing parameter is normalized, serial 0, parallel 0.5, stereo 1
+	filterRoutingComboBox = addComboBox(292, 230, 80, ownerFilter, FILTERROUTING);
+	filterRoutingComboBox->addItem(T("Serial"),1);
+	filterRoutingComboBox->addItem(T("Parallel"),2);
+	filterRoutingComboBox->addItem(T("Stereo"),3);
+	filterRoutingComboBox->setSelectedId(getFilterRoutingId(ownerFilter->getParameter(FILTERROUTING)), true);
+
 	// LFO's
     lfo1WaveformKnob = addNormalKnob(92, 150, ownerFilter, lfoWaveformImage, 6, LFO1WAVEFORM);
 	lfo2WaveformKnob = addNormalKnob(92, 387, ownerFilter, lfoWaveformImage, 6, LFO2WAVEFORM);
@@ -152,6 +184,92 @@ TalComponent::TalComponent (TalCore* const ownerFilter)
 	freeAdDestinationComboBox->addItem(T("PW"),5);
 	freeAdDestinationComboBox->addItem(T("FM"),6);
 
+	// Modulation matrix, two columns of 4 slots below the background image
+	int panelY = internalCachedBackgroundImage.getHeight();
+	addLabel(20, panelY + 6, 200, T("Modulation matrix"));
+	for (int slot = 0; slot < ModulationMatrix::NUM_SLOTS; slot++)
+	{
+		int x = 20 + (slot / 4) * 325;
+		int y = panelY + 30 + (slot % 4) * 40;
+		int parameter = MODMATRIX + slot * ModulationMatrix::PARAMETERS_PER_SLOT;
+
+		addLabel(x, y + 9, 15, String(slot + 1));
+
+		modSourceComboBoxes[slot] = addComboBox(x + 15, y + 9, 80, ownerFilter, parameter);
+		modSourceComboBoxes[slot]->addItem(T("Off"),1);
+		modSourceComboBoxes[slot]->addItem(T("Lfo1"),2);
+		modSourceComboBoxes[slot]->addItem(T("Lfo2"),3);
+		modSourceComboBoxes[slot]->addItem(T("Free AD"),4);
+		modSourceComboBoxes[slot]->addItem(T("Filter env"),5);
+		modSourceComboBoxes[slot]->addItem(T("Amp env"),6);
+		modSourceComboBoxes[slot]->addItem(T("Velocity"),7);
+		modSourceComboBoxes[slot]->addItem(T("Key"),8);
+		modSourceComboBoxes[slot]->addItem(T("Pitchwheel"),9);
+		modSourceComboBoxes[slot]->addItem(T("Modwheel"),10);
+		modSourceComboBoxes[slot]->addItem(T("Aftertouch"),11);
+		modSourceComboBoxes[slot]->addItem(T("Pressure"),12);
+		modSourceComboBoxes[slot]->addItem(T("Slide"),13);
+
+		modDestinationComboBoxes[slot] = addComboBox(x + 100, y + 9, 80, ownerFilter, parameter + 1);
+		modDestinationComboBoxes[slot]->addItem(T("Off"),1);
+		modDestinationComboBoxes[slot]->addItem(T("Cutoff"),2);
+		modDestinationComboBoxes[slot]->addItem(T("Resonance"),3);
+		modDestinationComboBoxes[slot]->addItem(T("Pitch"),4);
+		modDestinationComboBoxes[slot]->addItem(T("Osc1 pitch"),5);
+		modDestinationComboBoxes[slot]->addItem(T("Osc2 pitch"),6);
+		modDestinationComboBoxes[slot]->addItem(T("PW"),7);
+		modDestinationComboBoxes[slot]->addItem(T("FM"),8);
+		modDestinationComboBoxes[slot]->addItem(T("Pan"),9);
+		modDestinationComboBoxes[slot]->addItem(T("Volume"),10);
+		modDestinationComboBoxes[slot]->addItem(T("Reverb send"),11);
+
+		modAmountKnobs[slot] = addNormalKnob(x + 185, y, ownerFilter, darkKnobImage, numberOfImages, parameter + 2);
+
+		modCurveComboBoxes[slot] = addComboBox(x + 230, y + 9, 60, ownerFilter, parameter + 3);
+		modCurveComboBoxes[slot]->addItem(T("Linear"),1);
+		modCurveComboBoxes[slot]->addItem(T("Exp"),2);
+		modCurveComboBoxes[slot]->addItem(T("Log"),3);
+	}
+
+	// Settings, the label above every control
+	int settingsY = panelY + 200;
+	addLabel(20, settingsY, 80, T("Lfo per voice"));
+	lfoPerVoiceButton = addNormalButton(30, settingsY + 20, ownerFilter, buttonImage, false, LFOPERVOICE);
+
+	addLabel(100, settingsY, 80, T("MPE"));
+	mpeModeButton = addNormalButton(110, settingsY + 20, ownerFilter, buttonImage, false, MPEMODE);
+
+	addLabel(180, settingsY, 80, T("Glide"));
+	glideModeComboBox = addComboBox(180, settingsY + 20, 70, ownerFilter, GLIDEMODE);
+	glideModeComboBox->addItem(T("Rate"),1);
+	glideModeComboBox->addItem(T("Time"),2);
+
+	addLabel(260, settingsY, 80, T("Velocity"));
+	velocityCurveComboBox = addComboBox(260, settingsY + 20, 70, ownerFilter, VELOCITYCURVE);
+	velocityCurveComboBox->addItem(T("Linear"),1);
+	velocityCurveComboBox->addItem(T("Exp"),2);
+	velocityCurveComboBox->addItem(T("Log"),3);
+
+	addLabel(340, settingsY, 80, T("Keyfollow"));
+	keyfollowCurveComboBox = addComboBox(340, settingsY + 20, 70, ownerFilter, KEYFOLLOWCURVE);
+	keyfollowCurveComboBox->addItem(T("Linear"),1);
+	keyfollowCurveComboBox->addItem(T("Exp"),2);
+	keyfollowCurveComboBox->addItem(T("Log"),3);
+
+	addLabel(420, settingsY, 80, T("Reverb"));
+	reverbModeComboBox = addComboBox(420, settingsY + 20, 70, ownerFilter, REVERBMODE);
+	reverbModeComboBox->addItem(T("Comb"),1);
+	reverbModeComboBox->addItem(T("FDN"),2);
+
+	addLabel(500, settingsY, 80, T("Silence"));
+	silenceThresholdKnob = addNormalKnob(505, settingsY + 14, ownerFilter, darkKnobImage, numberOfImages, SILENCETHRESHOLD);
+
+	// Shared effects is an instance setting, not a parameter
+	addLabel(580, settingsY, 80, T("Shared fx"));
+	addAndMakeVisible(sharedEffectsButton = new ImageToggleButton("Toggle Button", buttonImage, false, false));
+	sharedEffectsButton->setBounds(590, settingsY + 20, buttonImage.getWidth(), buttonImage.getHeight() / 2);
+	sharedEffectsButton->addButtonListener(this);
+
     infoText = new Label("Info Text", "-");
 	infoText->setBounds(527, 530, 62, 20);
     infoText->setJustificationType(juce::Justification::centred);
@@ -171,7 +289,7 @@ TalComponent::TalComponent (TalCore* const ownerFilter)
     addAndMakeVisible(hyperlinkButtoon);
 
     // set our component's initial size to be the last one that was stored in the filter's settings
-    setSize (internalCachedBackgroundImage.getWidth(), internalCachedBackgroundImage.getHeight());
+    setSize (internalCachedBackgroundImage.getWidth(), internalCachedBackgroundImage.getHeight() + PANEL_HEIGHT);
 
     // register ourselves with the filter - it will use its ChangeBroadcaster base
     // class to tell us when something has changed, and this will call our changeListenerCallback()
@@ -234,6 +352,16 @@ ComboBox* TalComponent::addComboBox(int x, int y, int width, TalCore* const owne
 	return comboBox;
 }
 
+Label* TalComponent::addLabel(int x, int y, int width, const String& text)
+{
+	Label *label;
+	addAndMakeVisible(label = new Label(T("Label"), text));
+	label->setBounds(x, y, width, 20);
+	label->setFont(Font(11.0f));
+	label->setColour(Label::textColourId, Colour::greyLevel(1.0f));
+	return label;
+}
+
 //==============================================================================
 void TalComponent::paint (Graphics& g)
 {
@@ -244,6 +372,10 @@ void TalComponent::paint (Graphics& g)
     g.drawImage (image,
                  0, 0, image.getWidth(), image.getHeight(),
                  0, 0, image.getWidth(), image.getHeight());
+
+    // Modulation matrix and settings panel
+    g.setColour (Colour::greyLevel (0.15f));
+    g.fillRect (0, image.getHeight(), image.getWidth(), PANEL_HEIGHT);
 }
 
 //==============================================================================
@@ -262,6 +394,8 @@ void TalComponent::sliderValueChanged (Slider* caller)
 	if (caller == resonanceKnob) filter->setParameterNotifyingHost(RESONANCE, (float)resonanceKnob->getValue());
 	if (caller == filterContourKnob) filter->setParameterNotifyingHost(FILTERCONTOUR, (float)filterContourKnob->getValue());
 	if (caller == keyfollowKnob) filter->setParameterNotifyingHost(KEYFOLLOW, (float)keyfollowKnob->getValue());
+	if (caller == filter2CutoffKnob) filter->setParameterNotifyingHost(FILTER2CUTOFF, (float)filter2CutoffKnob->getValue());
+	if (caller == filter2ResonanceKnob) filter->setParameterNotifyingHost(FILTER2RESONANCE, (float)filter2ResonanceKnob->getValue());
 	
 	if (caller == filterAttackKnob) filter->setParameterNotifyingHost(FILTERATTACK, (float)filterAttackKnob->getValue());
 	if (caller == filterDecayKnob) filter->setParameterNotifyingHost(FILTERDECAY, (float)filterDecayKnob->getValue());
@@ -322,6 +456,13 @@ void TalComponent::sliderValueChanged (Slider* caller)
 	if (caller == reverbLowCutKnob) filter->setParameterNotifyingHost(REVERBLOWCUT, (float)reverbLowCutKnob->getValue());
 	
     if (caller == oscBitcrusherKnob) filter->setParameterNotifyingHost(OSCBITCRUSHER, (float)oscBitcrusherKnob->getValue());
+	if (caller == silenceThresholdKnob) filter->setParameterNotifyingHost(SILENCETHRESHOLD, (float)silenceThresholdKnob->getValue());
+
+	for (int slot = 0; slot < ModulationMatrix::NUM_SLOTS; slot++)
+	{
+		int parameter = MODMATRIX + slot * ModulationMatrix::PARAMETERS_PER_SLOT;
+		if (caller == modAmountKnobs[slot]) filter->setParameterNotifyingHost(parameter + 2, (float)modAmountKnobs[slot]->getValue());
+	}
     this->updateInfo(caller);
 }
 
@@ -329,6 +470,16 @@ void TalComponent::updateInfo(Slider* caller)
 {
     // FIXME: Refactor
     TalCore* const filter = getFilter();
+    for (int slot = 0; slot < ModulationMatrix::NUM_SLOTS; slot++)
+    {
+        if (caller == modAmountKnobs[slot])
+        {
+            // Modulation amount [-1..1]
+            infoText->setText(juce::String(((float)caller->getValue() - 0.5f) * 2.0f, 2), false);
+            return;
+        }
+    }
+
     if (caller == osc1TuneKnob || caller == osc2TuneKnob)
     {
         infoText->setText(juce::String(audioUtils.getOscTuneValue((float)caller->getValue()), 0), false);
@@ -365,6 +516,10 @@ void TalComponent::updateInfo(Slider* caller)
     {
         infoText->setText(juce::String(audioUtils.getLogScaledLinearValueCentered((float)caller->getValue()), 2), false);
     }
+    else if (caller == silenceThresholdKnob)
+    {
+        infoText->setText(juce::String(-140.0f + 80.0f * (float)caller->getValue(), 1) + T(" dB"), false);
+    }
     else if (caller == lfo1RateKnob || caller == lfo2RateKnob)
     {
         float isSync = false;
@@ -375,9 +530,7 @@ void TalComponent::updateInfo(Slider* caller)
         }
         if (isSync)
         {
-            float value = (float)caller->getValue();
-            char *text = audioUtils.getSyncedRateAndGetText(&value, filter->getBpm());
-            infoText->setText(juce::String(text), false);
+            infoText->setText(juce::String(audioUtils.getSyncedRateText((float)caller->getValue())), false);
         }
         else
         {
@@ -402,6 +555,9 @@ void TalComponent::buttonClicked (Button* caller)
 	if (caller == lfo2KeyTriggerButton) filter->setParameterNotifyingHost(LFO2KEYTRIGGER, (float)caller->getToggleState());
 	if (caller == chorus1Button) filter->setParameterNotifyingHost(CHORUS1ENABLE, (float)caller->getToggleState());
 	if (caller == chorus2Button) filter->setParameterNotifyingHost(CHORUS2ENABLE, (float)caller->getToggleState());
+	if (caller == lfoPerVoiceButton) filter->setParameterNotifyingHost(LFOPERVOICE, (float)caller->getToggleState());
+	if (caller == mpeModeButton) filter->setParameterNotifyingHost(MPEMODE, (float)caller->getToggleState());
+	if (caller == sharedEffectsButton) filter->setSharedEffects(caller->getToggleState());
 }
 
 void TalComponent::comboBoxChanged (ComboBox* caller)
@@ -413,6 +569,20 @@ void TalComponent::comboBoxChanged (ComboBox* caller)
 	if (caller == lfo2DestinationComboBox) filter->setParameterNotifyingHost(LFO2DESTINATION, (float)lfo2DestinationComboBox->getSelectedId());
 	if (caller == freeAdDestinationComboBox) filter->setParameterNotifyingHost(FREEADDESTINATION, (float)freeAdDestinationComboBox->getSelectedId());
 	if (caller == filtertypeComboBox) filter->setParameterNotifyingHost(FILTERTYPE, (float)filtertypeComboBox->getSelectedId());
+	if (caller == filter2typeComboBox) filter->setParameterNotifyingHost(FILTER2TYPE, (float)(filter2typeComboBox->getSelectedId() - 1));
+	if (caller == filterRoutingComboBox) filter->setParameterNotifyingHost(FILTERROUTING, (float)(filterRoutingComboBox->getSelectedId() - 1) * 0.5f);
+	if (caller == glideModeComboBox) filter->setParameterNotifyingHost(GLIDEMODE, getComboBoxValue(glideModeComboBox));
+	if (caller == velocityCurveComboBox) filter->setParameterNotifyingHost(VELOCITYCURVE, getComboBoxValue(velocityCurveComboBox));
+	if (caller == keyfollowCurveComboBox) filter->setParameterNotifyingHost(KEYFOLLOWCURVE, getComboBoxValue(keyfollowCurveComboBox));
+	if (caller == reverbModeComboBox) filter->setParameterNotifyingHost(REVERBMODE, getComboBoxValue(reverbModeComboBox));
+
+	for (int slot = 0; slot < ModulationMatrix::NUM_SLOTS; slot++)
+	{
+		int parameter = MODMATRIX + slot * ModulationMatrix::PARAMETERS_PER_SLOT;
+		if (caller == modSourceComboBoxes[slot]) filter->setParameterNotifyingHost(parameter, getComboBoxValue(modSourceComboBoxes[slot]));
+		if (caller == modDestinationComboBoxes[slot]) filter->setParameterNotifyingHost(parameter + 1, getComboBoxValue(modDestinationComboBoxes[slot]));
+		if (caller == modCurveComboBoxes[slot]) filter->setParameterNotifyingHost(parameter + 3, getComboBoxValue(modCurveComboBoxes[slot]));
+	}
 }
 
 //==============================================================================
@@ -510,6 +680,25 @@ void TalComponent::updateParametersFromFilter()
 
     float oscBitcrusher = filter->getParameter(OSCBITCRUSHER);
     float filtertype = filter->getParameter(FILTERTYPE);
+    float filter2type = filter->getParameter(FILTER2TYPE);
+    float filter2Cutoff = filter->getParameter(FILTER2CUTOFF);
+    float filter2Resonance = filter->getParameter(FILTER2RESONANCE);
+    float filterRouting = filter->getParameter(FILTERROUTING);
+
+    float lfoPerVoice = filter->getParameter(LFOPERVOICE);
+    float mpeMode = filter->getParameter(MPEMODE);
+    float glideMode = filter->getParameter(GLIDEMODE);
+    float velocityCurve = filter->getParameter(VELOCITYCURVE);
+    float keyfollowCurve = filter->getParameter(KEYFOLLOWCURVE);
+    float reverbMode = filter->getParameter(REVERBMODE);
+    float silenceThreshold = filter->getParameter(SILENCETHRESHOLD);
+    bool sharedEffects = filter->getSharedEffects();
+
+    float modMatrix[ModulationMatrix::NUM_SLOTS * ModulationMatrix::PARAMETERS_PER_SLOT];
+    for (int i = 0; i < ModulationMatrix::NUM_SLOTS * ModulationMatrix::PARAMETERS_PER_SLOT; i++)
+    {
+        modMatrix[i] = filter->getParameter(MODMATRIX + i);
+    }
 
     // ..release the lock ASAP
     filter->getCallbackLock().exit();
@@ -519,6 +708,8 @@ void TalComponent::updateParametersFromFilter()
 	resonanceKnob->setValue(resonance, false);
 	filterContourKnob->setValue(filterContour, false);
 	keyfollowKnob->setValue(keyfollow, false); 
+	filter2CutoffKnob->setValue(filter2Cutoff, false);
+	filter2ResonanceKnob->setValue(filter2Resonance, false);
 	filterAttackKnob->setValue(filterAttack, false);
 	filterDecayKnob->setValue(filterDecay, false);
 	filterSustainKnob->setValue(filterSustain, false); 
@@ -580,6 +771,7 @@ void TalComponent::updateParametersFromFilter()
     reverbLowCutKnob->setValue(reverbLowCut, false);
 
     oscBitcrusherKnob->setValue(oscBitcrusher, false);
+    silenceThresholdKnob->setValue(silenceThreshold, false);
 
 	// Buttons
 	oscSyncButton->setToggleState(oscSync, false);
@@ -589,6 +781,9 @@ void TalComponent::updateParametersFromFilter()
 	lfo2KeyTriggerButton->setToggleState(lfo2KeyTrigger > 0, false);
     chorus1Button->setToggleState(chorus1 > 0, false);
     chorus2Button->setToggleState(chorus2 > 0, false);
+	lfoPerVoiceButton->setToggleState(lfoPerVoice > 0, false);
+	mpeModeButton->setToggleState(mpeMode > 0, false);
+	sharedEffectsButton->setToggleState(sharedEffects, false);
 
 	// ComboBox
 	voicesComboBox->setSelectedId((int)voices, true); 
@@ -597,6 +792,57 @@ void TalComponent::updateParametersFromFilter()
 	lfo2DestinationComboBox->setSelectedId((int)lfo2Destination, true); 
 	freeAdDestinationComboBox->setSelectedId((int)freeAdDestination, true); 
 	filtertypeComboBox->setSelectedId((int)filtertype, true);
+	filter2typeComboBox->setSelectedId((int)filter2type + 1, true);
+	filterRoutingComboBox->setSelectedId(getFilterRoutingId(filterRouting), true);
+	glideModeComboBox->setSelectedId(glideMode > 0.0f ? 2 : 1, true);
+	velocityCurveComboBox->setSelectedId(getCurveId(velocityCurve), true);
+	keyfollowCurveComboBox->setSelectedId(getCurveId(keyfollowCurve), true);
+	reverbModeComboBox->setSelectedId(reverbMode > 0.0f ? 2 : 1, true);
+
+	// Modulation matrix
+	for (int slot = 0; slot < ModulationMatrix::NUM_SLOTS; slot++)
+	{
+		const float *values = modMatrix + slot * ModulationMatrix::PARAMETERS_PER_SLOT;
+		modSourceComboBoxes[slot]->setSelectedId(getComboBoxId(values[0], modSourceComboBoxes[slot]->getNumItems()), true);
+		modDestinationComboBoxes[slot]->setSelectedId(getComboBoxId(values[1], modDestinationComboBoxes[slot]->getNumItems()), true);
+		modAmountKnobs[slot]->setValue(values[2], false);
+		modCurveComboBoxes[slot]->setSelectedId(getComboBoxId(values[3], modCurveComboBoxes[slot]->getNumItems()), true);
+	}
+}
+
+// Same ranges as SynthEngine::getFilterRouting
+int TalComponent::getFilterRoutingId(float value)
+{
+	float valueSize = 1.0f / 3.0f - 0.001f;
+	if (value < valueSize) return 1;
+	if (value < valueSize * 2.0f) return 2;
+	return 3;
+}
+
+// Same ranges as TrackingCurve::setCurve
+int TalComponent::getCurveId(float value)
+{
+	int curve = (int)(value * (TrackingCurve::NUM_CURVES - 1.0f) + 0.000001f);
+	if (curve < 0) curve = 0;
+	if (curve >= TrackingCurve::NUM_CURVES) curve = TrackingCurve::NUM_CURVES - 1;
+	return curve + 1;
+}
+
+// Parameters that select one of numItems values spread over [0..1], same
+// rounding as ModulationMatrix
+int TalComponent::getComboBoxId(float value, int numItems)
+{
+	int index = (int)(value * (numItems - 1) + 0.5f);
+	if (index < 0) index = 0;
+	if (index >= numItems) index = numItems - 1;
+	return index + 1;
+}
+
+float TalComponent::getComboBoxValue(ComboBox* comboBox)
+{
+	int numItems = comboBox->getNumItems();
+	if (numItems < 2) return 0.0f;
+	return (float)(comboBox->getSelectedId() - 1) / (numItems - 1);
 }
 
 //==============================================================================
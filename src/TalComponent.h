@@ -124,6 +124,11 @@ class TalComponent   : public AudioProcessorEditor,
 	FilmStripKnob *filterContourKnob; 
 	FilmStripKnob *keyfollowKnob; 
 
+    ComboBox *filter2typeComboBox;
+    ComboBox *filterRoutingComboBox;
+	FilmStripKnob *filter2CutoffKnob;
+	FilmStripKnob *filter2ResonanceKnob;
+
 	FilmStripKnob *osc1VolumeKnob; 
 	FilmStripKnob *osc2VolumeKnob; 
 	FilmStripKnob *osc3VolumeKnob; 
@@ -206,6 +211,23 @@ class TalComponent   : public AudioProcessorEditor,
 	ImageToggleButton *lfo2SyncButton;
 	ImageToggleButton *lfo2KeyTriggerButton;
 
+	// Modulation matrix and settings panel below the background image
+	static const int PANEL_HEIGHT = 260;
+
+	ComboBox *modSourceComboBoxes[ModulationMatrix::NUM_SLOTS];
+	ComboBox *modDestinationComboBoxes[ModulationMatrix::NUM_SLOTS];
+	FilmStripKnob *modAmountKnobs[ModulationMatrix::NUM_SLOTS];
+	ComboBox *modCurveComboBoxes[ModulationMatrix::NUM_SLOTS];
+
+	ImageToggleButton *lfoPerVoiceButton;
+	ImageToggleButton *mpeModeButton;
+	ComboBox *glideModeComboBox;
+	ComboBox *velocityCurveComboBox;
+	ComboBox *keyfollowCurveComboBox;
+	ComboBox *reverbModeComboBox;
+	FilmStripKnob *silenceThresholdKnob;
+	ImageToggleButton *sharedEffectsButton;
+
 	Label *versionLabel;
     Label *infoText;
 
@@ -219,6 +241,11 @@ class TalComponent   : public AudioProcessorEditor,
 	ImageToggleButton* addNormalButton(int x, int y, TalCore* const ownerFilter, const Image buttonImage, bool isKickButton, int parameter);	
 	ImageSlider* addSlider(int x, int y, TalCore* const ownerFilter, const Image sliderImage, int height, int parameter);
 	ComboBox* addComboBox(int x, int y, int width, TalCore* const ownerFilter, int parameter);
+	Label* addLabel(int x, int y, int width, const String& text);
+	int getFilterRoutingId(float value);
+	int getCurveId(float value);
+	int getComboBoxId(float value, int numItems);
+	float getComboBoxValue(ComboBox* comboBox);
     void updateInfo(Slider* caller);
 
 	void setTooltip(Slider* slider);
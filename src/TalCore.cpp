@@ -53,6 +53,13 @@ TalCore::TalCore()
     engine = new SynthEngine(sampleRate);
     params = engine->param;
 
+    isSharedEffectsRequested = false;
+    isSharedEffects = false;
+    effectBusSlot = -1;
+    effectBufferSize = 0;
+    for (int i = 0; i < NUM_EFFECT_BUFFERS; i++) effectBuffers[i] = 0;
+    ensureEffectBufferSize(512);
+
     talPresets = new TalPreset*[NUMPROGRAMS];
 
     for (int i = 0; i < NUMPROGRAMS; i++) talPresets[i] = new TalPreset(); 
@@ -74,10 +81,17 @@ TalCore::TalCore()
     valueChangedMidiController = 0;
 
     this->bpm = 120.0f;
+
+    // Effects of the loaded program are ready before the first block
+    timerCallback();
+    startTimer(200);
 }
 
 TalCore::~TalCore()
 {
+    stopTimer();
+    if (isSharedEffects) SharedEffectBus::getInstance().unregisterInstance(this);
+    for (int i = 0; i < NUM_EFFECT_BUFFERS; i++) delete[] effectBuffers[i];
     if (talPresets) delete[] talPresets;
     if (engine) delete engine;
 }
@@ -112,6 +126,11 @@ void TalCore::setParameter (int index, float newValue)
         params[index] = newValue;
         talPresets[curProgram]->programData[index] = newValue;
 
+        if (index >= MODMATRIX && index <= MODMATRIXLAST)
+        {
+            engine->setModulationMatrix(index - MODMATRIX, newValue);
+        }
+
         switch(index)
         {
         case VOLUME:
@@ -279,6 +298,39 @@ void TalCore::setParameter (int index, float newValue)
         case DETUNE:
             engine->setDetune(newValue);
             break;
+        case SILENCETHRESHOLD:
+            engine->setSilenceThreshold(newValue);
+            break;
+        case FILTER2TYPE:
+            engine->setFilter2type(newValue);
+            break;
+        case FILTER2CUTOFF:
+            engine->setFilter2Cutoff(newValue);
+            break;
+        case FILTER2RESONANCE:
+            engine->setFilter2Resonance(newValue);
+            break;
+        case FILTERROUTING:
+            engine->setFilterRouting(newValue);
+            break;
+        case LFOPERVOICE:
+            engine->setLfoPerVoice(newValue);
+            break;
+        case MPEMODE:
+            engine->setMpeMode(newValue);
+            break;
+        case GLIDEMODE:
+            engine->setGlideMode(newValue);
+            break;
+        case VELOCITYCURVE:
+            engine->setVelocityCurve(newValue);
+            break;
+        case KEYFOLLOWCURVE:
+            engine->setKeyfollowCurve(newValue);
+            break;
+        case REVERBMODE:
+            engine->setReverbMode(newValue);
+            break;
         case OSCMASTERTUNE:
             engine->setMastertune(newValue);
             break;
@@ -325,6 +377,13 @@ void TalCore::setParameter (int index, float newValue)
 
 const String TalCore::getParameterName (int index)
 {
+    if (index >= MODMATRIX && index <= MODMATRIXLAST)
+    {
+        const char* names[] = { "source", "destination", "amount", "curve" };
+        int slot = (index - MODMATRIX) / ModulationMatrix::PARAMETERS_PER_SLOT;
+        return T("modslot") + String(slot + 1) + names[(index - MODMATRIX) % ModulationMatrix::PARAMETERS_PER_SLOT];
+    }
+
     switch(index)
     {
     case VOLUME: return T("volume");
@@ -395,6 +454,17 @@ const String TalCore::getParameterName (int index)
     case PITCHWHEELPITCH: return T("pitchwheelpitch");
     case HIGHPASS: return T("highpass");
     case DETUNE: return T("detune");
+    case SILENCETHRESHOLD: return T("silencethreshold");
+    case FILTER2TYPE: return T("filter2type");
+    case FILTER2CUTOFF: return T("filter2cutoff");
+    case FILTER2RESONANCE: return T("filter2resonance");
+    case FILTERROUTING: return T("filterrouting");
+    case LFOPERVOICE: return T("lfopervoice");
+    case MPEMODE: return T("mpemode");
+    case GLIDEMODE: return T("glidemode");
+    case VELOCITYCURVE: return T("velocitycurve");
+    case KEYFOLLOWCURVE: return T("keyfollowcurve");
+    case REVERBMODE: return T("reverbmode");
     case RINGMODULATION: return T("ringmodulation");
 
     case CHORUS1ENABLE: return T("chorus1enable");
@@ -452,6 +522,29 @@ bool TalCore::producesMidi() const
 
 void TalCore::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    // Keeps the timer from joining the bus with the old block size
+    const ScopedLock al (effectAllocationLock);
+    {
+        const ScopedLock sl (this->getCallbackLock());
+        ensureEffectBufferSize(samplesPerBlock);
+
+        // Only here, the host calls prepareToPlay before it renders at a new
+        // rate. Rebuilding the engine in processBlock would race the timer.
+        if (this->sampleRate != (float)sampleRate && sampleRate > 0.0)
+        {
+            this->sampleRate = (float)sampleRate;
+            engine->setSampleRate(this->sampleRate);
+            setCurrentProgram(curProgram);
+        }
+    }
+
+    // Grows the bus slot for the new block size. processBlock is not running,
+    // so the slot can be replaced.
+    if (isSharedEffects)
+    {
+        SharedEffectBus::getInstance().registerInstance(this, effectBufferSize);
+    }
+    timerCallback();
 }
 
 void TalCore::releaseResources()
@@ -463,14 +556,6 @@ void TalCore::releaseResources()
 void TalCore::processBlock (AudioSampleBuffer& buffer,
                             MidiBuffer& midiMessages)
 {
-    // Handle sample rate changes
-    if (sampleRate != this->getSampleRate())
-    {
-        sampleRate = this->getSampleRate();
-        engine->setSampleRate(sampleRate);
-        setCurrentProgram(curProgram);
-    }
-
     // Number of voices
     if (currentNumberOfVoices != params[VOICES])
     {
@@ -484,7 +569,7 @@ void TalCore::processBlock (AudioSampleBuffer& buffer,
     if (getPlayHead() != 0 && getPlayHead()->getCurrentPosition (pos))
     {
         this->bpm = pos.bpm;
-        this->engine->triggerLfoToHost(this->bpm, pos.ppqPosition);
+        this->engine->setHostPosition(pos.bpm, pos.ppqPosition, pos.isPlaying);
     }
     else
     {
@@ -510,19 +595,166 @@ void TalCore::processBlock (AudioSampleBuffer& buffer,
         float *samples0 = buffer.getSampleData(0, 0);
         float *samples1 = buffer.getSampleData(1, 0);
 
+        bool isShared = isSharedEffects;
+        float *effectSendL = effectBuffers[EFFECT_SEND_L];
+        float *effectSendR = effectBuffers[EFFECT_SEND_R];
+
+        // The effect buffers are sized in prepareToPlay. A host exceeding the
+        // announced block size is rendered in chunks instead of allocating here.
         int samplePos = 0;
-        int numSamples = buffer.getNumSamples();
-        while (numSamples > 0)
+        while (samplePos < bufferSize)
+        {
+            int chunkStart = samplePos;
+            int chunkEnd = bufferSize;
+            if (isShared && chunkEnd - chunkStart > effectBufferSize)
+            {
+                chunkEnd = chunkStart + effectBufferSize;
+            }
+
+            while (samplePos < chunkEnd)
+            {
+                processMidiPerSample(&midiIterator, samplePos);
+
+                // Render up to the next midi event in one go
+                int blockSize = chunkEnd - samplePos;
+                if (hasMidiMessage && midiEventPos - samplePos < blockSize)
+                {
+                    blockSize = midiEventPos - samplePos;
+                }
+
+                if (isShared)
+                {
+                    int sendPos = samplePos - chunkStart;
+                    engine->process(samples0 + samplePos, samples1 + samplePos, effectSendL + sendPos, effectSendR + sendPos, blockSize);
+                }
+                else
+                {
+                    engine->process(samples0 + samplePos, samples1 + samplePos, blockSize);
+                }
+
+                samplePos += blockSize;
+            }
+
+            if (isShared)
+            {
+                processSharedEffects(samples0 + chunkStart, samples1 + chunkStart, samplePos - chunkStart);
+            }
+        }
+    }
+}
+
+void TalCore::setSharedEffects(bool isEnabled)
+{
+    isSharedEffectsRequested = isEnabled;
+}
+
+bool TalCore::getSharedEffects()
+{
+    return isSharedEffectsRequested;
+}
+
+// On the timer thread, registering allocates and may wait for the owner
+void TalCore::updateSharedEffects()
+{
+    bool isEnabled = isSharedEffectsRequested;
+    if (isEnabled != isSharedEffects)
+    {
+        // The bus calls back into sharedEffectOwnerChanged, which takes the
+        // callback lock itself, so it is only held around the flag.
+        if (isEnabled)
+        {
+            int slot = SharedEffectBus::getInstance().registerInstance(this, effectBufferSize);
+            if (slot >= 0)
+            {
+                const ScopedLock sl (this->getCallbackLock());
+                effectBusSlot = slot;
+                isSharedEffects = true;
+            }
+        }
+        else
+        {
+            {
+                const ScopedLock sl (this->getCallbackLock());
+                isSharedEffects = false;
+            }
+            SharedEffectBus::getInstance().unregisterInstance(this);
+            effectBusSlot = -1;
+        }
+    }
+}
+
+// The dry signal is already in the output. The owner adds the chorus and reverb
+// of the summed bus input, with its own effect settings.
+void TalCore::processSharedEffects(float *samplesL, float *samplesR, int numSamples)
+{
+    SharedEffectBus &bus = SharedEffectBus::getInstance();
+    bus.addInput(effectBusSlot, samplesL, samplesR, effectBuffers[EFFECT_SEND_L], effectBuffers[EFFECT_SEND_R], numSamples);
+
+    if (bus.isOwner(this))
+    {
+        float *busL = effectBuffers[EFFECT_BUS_L];
+        float *busR = effectBuffers[EFFECT_BUS_R];
+        float *wetL = effectBuffers[EFFECT_WET_L];
+        float *wetR = effectBuffers[EFFECT_WET_R];
+        bus.takeInput(busL, busR, effectBuffers[EFFECT_SEND_L], effectBuffers[EFFECT_SEND_R], numSamples);
+
+        memcpy(wetL, busL, numSamples * sizeof(float));
+        memcpy(wetR, busR, numSamples * sizeof(float));
+        engine->processEffects(wetL, wetR, effectBuffers[EFFECT_SEND_L], effectBuffers[EFFECT_SEND_R], numSamples);
+
+        for (int i = 0; i < numSamples; i++)
         {
-            processMidiPerSample(&midiIterator, samplePos);
-            engine->process(samples0++, samples1++);
+            samplesL[i] += wetL[i] - busL[i];
+            samplesR[i] += wetR[i] - busR[i];
+        }
+    }
+}
 
-            numSamples--;
-            samplePos++;
+void TalCore::ensureEffectBufferSize(int numSamples)
+{
+    if (numSamples > effectBufferSize)
+    {
+        for (int i = 0; i < NUM_EFFECT_BUFFERS; i++)
+        {
+            delete[] effectBuffers[i];
+            effectBuffers[i] = new float[numSamples];
         }
+        effectBufferSize = numSamples;
     }
 }
 
+void TalCore::timerCallback()
+{
+    const ScopedLock al (effectAllocationLock);
+    updateSharedEffects();
+    updateEffectBuffers();
+}
+
+void TalCore::updateEffectBuffers()
+{
+    // Effects of instances that do not own the shared bus are never rendered
+    bool isEffectUsed = !isSharedEffects || SharedEffectBus::getInstance().isOwner(this);
+    {
+        const ScopedLock sl (this->getCallbackLock());
+        engine->updateEffectAllocation(isEffectUsed);
+    }
+
+    if (engine->allocateEffectBuffers())
+    {
+        const ScopedLock sl (this->getCallbackLock());
+        engine->swapEffectBuffers();
+    }
+    engine->freeEffectBuffers();
+}
+
+// Called by the bus off the audio thread. A new owner allocates its effect
+// buffers right away instead of waiting for the next timer tick.
+void TalCore::sharedEffectOwnerChanged()
+{
+    const ScopedLock al (effectAllocationLock);
+    updateEffectBuffers();
+}
+
 float TalCore::getBpm()
 {
     return this->bpm;
@@ -535,21 +767,38 @@ inline void TalCore::processMidiPerSample(MidiBuffer::Iterator *midiIterator, co
     {
         if (midiMessage->isController())
         {
+            // The mod wheel is a modulation source, learned mappings still apply
+            if (midiMessage->getControllerNumber() == 1)
+            {
+                engine->setModWheel(midiMessage->getControllerValue() / 127.0f);
+            }
+            else if (midiMessage->getControllerNumber() == 74 && engine->getMpeMode())
+            {
+                engine->setSlide(midiMessage->getChannel(), midiMessage->getControllerValue() / 127.0f);
+            }
             handleController (midiMessage->getControllerNumber(),
                 midiMessage->getControllerValue());
         }
         else if (midiMessage->isNoteOn())
         {
-            engine->setNoteOn(midiMessage->getNoteNumber(), midiMessage->getFloatVelocity());
+            engine->setNoteOn(midiMessage->getNoteNumber(), midiMessage->getFloatVelocity(), midiMessage->getChannel());
         }
         else if (midiMessage->isNoteOff())
         {
-            engine->setNoteOff(midiMessage->getNoteNumber());
+            engine->setNoteOff(midiMessage->getNoteNumber(), midiMessage->getChannel());
         }
         else if (midiMessage->isPitchWheel())
         {
             // [0..16383] center = 8192;
-            engine->setPitchwheelAmount((midiMessage->getPitchWheelValue() - 8192.0f) / (16383.0f * 0.5f));
+            engine->setPitchwheel(midiMessage->getChannel(), (midiMessage->getPitchWheelValue() - 8192.0f) / (16383.0f * 0.5f));
+        }
+        else if (midiMessage->isAftertouch())
+        {
+            engine->setAftertouch(midiMessage->getNoteNumber(), midiMessage->getChannel(), midiMessage->getAfterTouchValue() / 127.0f);
+        }
+        else if (midiMessage->isChannelPressure())
+        {
+            engine->setChannelPressure(midiMessage->getChannel(), midiMessage->getChannelPressureValue() / 127.0f);
         }
     }
 }
@@ -594,6 +843,7 @@ void TalCore::getStateInformation (MemoryBlock& destData)
     XmlElement tal("tal");
     tal.setAttribute (T("curprogram"), curProgram);
     tal.setAttribute (T("version"), 1);
+    tal.setAttribute (T("sharedeffects"), isSharedEffectsRequested ? 1 : 0);
 
     // programs
     XmlElement *programList = new XmlElement ("programs");
@@ -625,6 +875,7 @@ void TalCore::setStateInformation (const void* data, int sizeInBytes)
     if (xmlState != 0 && xmlState->hasTagName(T("tal")))
     {
         curProgram = (int)xmlState->getIntAttribute (T("curprogram"), 1);
+        setSharedEffects(xmlState->getIntAttribute (T("sharedeffects"), 0) > 0);
         XmlElement* programs = xmlState->getFirstChildElement();
         if (programs->hasTagName(T("programs")))
         {
@@ -716,6 +967,17 @@ void TalCore::getXmlPrograms(XmlElement *programList, int programNumber)
         program->setAttribute (T("pitchwheelpitch"), talPresets[programNumber]->programData[PITCHWHEELPITCH]);
         program->setAttribute (T("highpass"), talPresets[programNumber]->programData[HIGHPASS]);
         program->setAttribute (T("detune"), talPresets[programNumber]->programData[DETUNE]);
+        program->setAttribute (T("silencethreshold"), talPresets[programNumber]->programData[SILENCETHRESHOLD]);
+        program->setAttribute (T("filter2type"), talPresets[programNumber]->programData[FILTER2TYPE]);
+        program->setAttribute (T("filter2cutoff"), talPresets[programNumber]->programData[FILTER2CUTOFF]);
+        program->setAttribute (T("filter2resonance"), talPresets[programNumber]->programData[FILTER2RESONANCE]);
+        program->setAttribute (T("filterrouting"), talPresets[programNumber]->programData[FILTERROUTING]);
+        program->setAttribute (T("lfopervoice"), talPresets[programNumber]->programData[LFOPERVOICE]);
+        program->setAttribute (T("mpemode"), talPresets[programNumber]->programData[MPEMODE]);
+        program->setAttribute (T("glidemode"), talPresets[programNumber]->programData[GLIDEMODE]);
+        program->setAttribute (T("velocitycurve"), talPresets[programNumber]->programData[VELOCITYCURVE]);
+        program->setAttribute (T("keyfollowcurve"), talPresets[programNumber]->programData[KEYFOLLOWCURVE]);
+        program->setAttribute (T("reverbmode"), talPresets[programNumber]->programData[REVERBMODE]);
         program->setAttribute (T("ringmodulation"), talPresets[programNumber]->programData[RINGMODULATION]);
 
         program->setAttribute (T("chorus1enable"), talPresets[programNumber]->programData[CHORUS1ENABLE]);
@@ -727,6 +989,11 @@ void TalCore::getXmlPrograms(XmlElement *programList, int programNumber)
         program->setAttribute (T("reverbhighcut"), talPresets[programNumber]->programData[REVERBHIGHCUT]);
         program->setAttribute (T("reverblowcut"), talPresets[programNumber]->programData[REVERBLOWCUT]);
         program->setAttribute (T("oscbitcrusher"), talPresets[programNumber]->programData[OSCBITCRUSHER]);
+
+        for (int i = MODMATRIX; i <= MODMATRIXLAST; i++)
+        {
+            program->setAttribute (getParameterName(i), talPresets[programNumber]->programData[i]);
+        }
         programList->addChildElement(program);
 }
 
@@ -803,6 +1070,17 @@ void TalCore::setXmlPrograms(XmlElement* e, int programNumber)
         talPresets[programNumber]->programData[PITCHWHEELPITCH] = (float) e->getDoubleAttribute (T("pitchwheelpitch"), 0.0f);
         talPresets[programNumber]->programData[HIGHPASS] = (float) e->getDoubleAttribute (T("highpass"), 0.0f);
         talPresets[programNumber]->programData[DETUNE] = (float) e->getDoubleAttribute (T("detune"), 0.0f);
+        talPresets[programNumber]->programData[SILENCETHRESHOLD] = (float) e->getDoubleAttribute (T("silencethreshold"), 0.5f);
+        talPresets[programNumber]->programData[FILTER2TYPE] = (float) e->getDoubleAttribute (T("filter2type"), 0.0f);
+        talPresets[programNumber]->programData[FILTER2CUTOFF] = (float) e->getDoubleAttribute (T("filter2cutoff"), 0.5f);
+        talPresets[programNumber]->programData[FILTER2RESONANCE] = (float) e->getDoubleAttribute (T("filter2resonance"), 0.0f);
+        talPresets[programNumber]->programData[FILTERROUTING] = (float) e->getDoubleAttribute (T("filterrouting"), 0.0f);
+        talPresets[programNumber]->programData[LFOPERVOICE] = (float) e->getDoubleAttribute (T("lfopervoice"), 0.0f);
+        talPresets[programNumber]->programData[MPEMODE] = (float) e->getDoubleAttribute (T("mpemode"), 0.0f);
+        talPresets[programNumber]->programData[GLIDEMODE] = (float) e->getDoubleAttribute (T("glidemode"), 0.0f);
+        talPresets[programNumber]->programData[VELOCITYCURVE] = (float) e->getDoubleAttribute (T("velocitycurve"), 0.0f);
+        talPresets[programNumber]->programData[KEYFOLLOWCURVE] = (float) e->getDoubleAttribute (T("keyfollowcurve"), 0.0f);
+        talPresets[programNumber]->programData[REVERBMODE] = (float) e->getDoubleAttribute (T("reverbmode"), 0.0f);
         talPresets[programNumber]->programData[RINGMODULATION] = (float) e->getDoubleAttribute (T("ringmodulation"), 0.0f);
         talPresets[programNumber]->programData[CHORUS1ENABLE] = (float) e->getDoubleAttribute (T("chorus1enable"), 0.0f);
         talPresets[programNumber]->programData[CHORUS2ENABLE] = (float) e->getDoubleAttribute (T("chorus2enable"), 0.0f);
@@ -814,6 +1092,13 @@ void TalCore::setXmlPrograms(XmlElement* e, int programNumber)
         talPresets[programNumber]->programData[REVERBLOWCUT] = (float) e->getDoubleAttribute (T("reverblowcut"), 1.0f);
 
         talPresets[programNumber]->programData[OSCBITCRUSHER] = (float) e->getDoubleAttribute (T("oscbitcrusher"), 1.0f);
+
+        // The amounts are centered
+        for (int i = MODMATRIX; i <= MODMATRIXLAST; i++)
+        {
+            bool isAmount = (i - MODMATRIX) % ModulationMatrix::PARAMETERS_PER_SLOT == 2;
+            talPresets[programNumber]->programData[i] = (float) e->getDoubleAttribute (getParameterName(i), isAmount ? 0.5f : 0.0f);
+        }
     }
 }
 
@@ -35,6 +35,7 @@
 #include "./engine/SynthEngine.h"
 #include "./engine/Params.h"
 #include "TalPreset.h"
+#include "SharedEffectBus.h"
 
 //==============================================================================
 /**
@@ -44,7 +45,9 @@
 */
 
 class TalCore  : public AudioProcessor,
-                 public ChangeBroadcaster
+                 public ChangeBroadcaster,
+                 public Timer,
+                 public SharedEffectBus::Listener
 {
 public:
     //==============================================================================
@@ -103,6 +106,15 @@ class TalCore  : public AudioProcessor,
     bool getNextEvent (MidiBuffer::Iterator *midiIterator, int samplePos);
 
     float getBpm();
+
+    // Allocates and releases the effect buffers off the audio thread
+    void timerCallback();
+    void sharedEffectOwnerChanged();
+
+    // Routing of the whole process, so an instance setting rather than a
+    // program parameter. The bus is joined or left on the next timer tick.
+    void setSharedEffects(bool isEnabled);
+    bool getSharedEffects();
     int getValueChangedMidiController();
 
 
@@ -148,5 +160,31 @@ class TalCore  : public AudioProcessor,
     MidiMessage *midiMessage;
 
     float bpm;
+
+    // Shared effect bus
+    enum EffectBuffer
+    {
+        EFFECT_SEND_L = 0,
+        EFFECT_SEND_R,
+        EFFECT_BUS_L,
+        EFFECT_BUS_R,
+        EFFECT_WET_L,
+        EFFECT_WET_R,
+        NUM_EFFECT_BUFFERS
+    };
+
+    bool isSharedEffectsRequested;
+    bool isSharedEffects;
+    int effectBusSlot;
+    float *effectBuffers[NUM_EFFECT_BUFFERS];
+    int effectBufferSize;
+
+    // The timer and the shared effect bus both allocate effect buffers
+    CriticalSection effectAllocationLock;
+
+    void updateSharedEffects();
+    void updateEffectBuffers();
+    void processSharedEffects(float *samplesL, float *samplesR, int numSamples);
+    void ensureEffectBufferSize(int numSamples);
 };
 #endif